@@ -0,0 +1,227 @@
+//
+//  Benchmark.cpp
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Microbenchmarks for core GP operations, to catch performance regressions and
+// to evaluate optimizations. Each benchmark runs an operation repeatedly (for
+// at least a minimum time) and reports time, heap allocations, and allocated
+// bytes per operation. All use fixed random seeds so runs are reproducible.
+//
+// Usage: lazy_predator_benchmark [--csv] [--quick] [--profile] [name ...]
+//     --csv      write results as CSV rather than a table.
+//     --quick    shorter runs, and Population sizes only up to 10,000.
+//     --profile  enable GpFunctionProfiler, print its report at end.
+//     Only benchmarks whose name contains one of the substrings are run.
+
+#include "LazyPredator.h"
+#include "TestFS.h"
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+// Count heap allocations, via replacement global operator new/delete. (The
+// array forms call these.) Not inlined, so GCC does not see malloc()/free()
+// paired with new/delete expressions and warn of a mismatch.
+namespace AllocationCounter
+{
+    std::atomic<uint64_t> count(0);
+    std::atomic<uint64_t> bytes(0);
+    void* allocate(size_t size, size_t alignment)
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+        GpFunctionProfiler::countAllocation(size);
+        // aligned_alloc() requires size to be a multiple of alignment.
+        size = std::max(size_t(1), size);
+        size = ((size + alignment - 1) / alignment) * alignment;
+        void* p = ((alignment <= alignof(std::max_align_t)) ?
+                   std::malloc(size) : std::aligned_alloc(alignment, size));
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+}
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    return AllocationCounter::allocate(size, alignof(std::max_align_t));
+}
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t a)
+{
+    return AllocationCounter::allocate(size, size_t(a));
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+__attribute__((noinline)) void operator delete(void* p,
+                                               std::align_val_t) noexcept
+{
+    std::free(p);
+}
+__attribute__((noinline)) void operator delete(void* p,
+                                               size_t,
+                                               std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+class Benchmark
+{
+public:
+    Benchmark(int argc, const char* argv[])
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--csv") { csv_ = true; }
+            else if (arg == "--quick") { quick_ = true; }
+            else if (arg == "--profile") { profile_ = true; }
+            else { filters_.push_back(arg); }
+        }
+        min_time_ = quick_ ? 0.05 : 0.25;
+        if (csv_) std::cout << "name,ns_per_op,allocs_per_op,bytes_per_op\n";
+        GpFunctionProfiler::setEnabled(profile_);
+    }
+    ~Benchmark() { if (profile_) GpFunctionProfiler::print(); }
+    bool quick() const { return quick_; }
+
+    // Time operation "op" repeatedly. "setup" (optional) runs before timing.
+    void run(const std::string& name,
+             std::function<void()> op,
+             std::function<void()> setup = nullptr)
+    {
+        if (!selected(name)) return;
+        LPRS().setSeed(1234567);
+        if (setup) setup();
+        op();  // Warm up.
+        // Repeat with increasing iteration counts until min_time_ is reached.
+        int iterations = 1;
+        while (true)
+        {
+            uint64_t count0 = AllocationCounter::count;
+            uint64_t bytes0 = AllocationCounter::bytes;
+            TimePoint start = TimeClock::now();
+            for (int i = 0; i < iterations; i++) { op(); }
+            TimeDuration elapsed = TimeClock::now() - start;
+            if ((elapsed.count() >= min_time_) || (iterations >= 1e8))
+            {
+                report(name,
+                       elapsed.count() * 1e9 / iterations,
+                       double(AllocationCounter::count - count0) / iterations,
+                       double(AllocationCounter::bytes - bytes0) / iterations);
+                break;
+            }
+            double scale = min_time_ / std::max(elapsed.count(), 1e-9);
+            iterations = int(std::min(iterations * 10.0,
+                                      std::max(iterations * 1.5,
+                                               iterations * scale * 1.2)));
+        }
+    }
+private:
+    bool selected(const std::string& name) const
+    {
+        bool ok = filters_.empty();
+        for (auto& f : filters_) if (name.find(f) != std::string::npos) ok = true;
+        return ok;
+    }
+    void report(const std::string& name, double ns, double allocs, double bytes)
+    {
+        if (csv_)
+        {
+            std::cout << name << "," << ns << "," << allocs << "," << bytes;
+        }
+        else
+        {
+            std::cout << std::left << std::setw(44) << name << std::right;
+            std::cout << std::fixed << std::setprecision(1);
+            std::cout << std::setw(14) << ns << " ns/op";
+            std::cout << std::setw(11) << allocs << " allocs/op";
+            std::cout << std::setw(13) << bytes << " bytes/op";
+            std::cout << std::defaultfloat;
+        }
+        std::cout << std::endl;
+    }
+    bool csv_ = false;
+    bool quick_ = false;
+    bool profile_ = false;
+    double min_time_ = 0.25;
+    std::vector<std::string> filters_;
+};
+
+int main(int argc, const char* argv[])
+{
+    Benchmark benchmark(argc, argv);
+    const FunctionSet& fs = TestFS::treeEval();
+    std::vector<int> tree_sizes = {10, 50, 200};
+
+    for (int size : tree_sizes)
+    {
+        std::string s = std::to_string(size);
+        GpTree a, b, c;
+        auto make_trees = [&]()
+        {
+            a = GpTree();
+            b = GpTree();
+            fs.makeRandomTree(size, a);
+            fs.makeRandomTree(size, b);
+        };
+        benchmark.run("makeRandomTree/" + s, [&]()
+        {
+            GpTree t;
+            fs.makeRandomTree(size, t);
+        });
+        benchmark.run("GpTree_copy/" + s, [&](){ GpTree copy = a; }, make_trees);
+        benchmark.run("crossover/" + s, [&]()
+        {
+            GpTree::crossover(a, b, c, size / 2, size * 3 / 2,
+                              fs.getCrossoverMinSize());
+        }, make_trees);
+        benchmark.run("mutate/" + s, [&](){ a.mutate(); }, make_trees);
+        benchmark.run("eval/" + s, [&](){ a.eval(); }, make_trees);
+        GpTypeSet types = { fs.lookupGpTypeByName("Float") };
+        benchmark.run("selectCrossoverSubtree/" + s, [&]()
+        {
+            a.selectCrossoverSubtree(fs.getCrossoverMinSize(), 0, types);
+        }, make_trees);
+        benchmark.run("to_string/" + s, [&](){ a.to_string(true); }, make_trees);
+    }
+
+    std::vector<int> population_sizes = {100, 1000, 10000, 100000};
+    if (benchmark.quick()) population_sizes.pop_back();
+    for (int size : population_sizes)
+    {
+        std::string s = std::to_string(size);
+        std::unique_ptr<Population> population;
+        auto make_population = [&]()
+        {
+            population = nullptr;
+            population = std::make_unique<Population>(size, 20, fs);
+            population->setLoggerFunction([](Population&){});
+            float fitness = 0;
+            population->applyToAllIndividuals([&](Individual* i)
+                                              { i->setFitness(fitness++); });
+        };
+        benchmark.run("updateSortedCollectionOfIndividuals/" + s, [&]()
+        {
+            population->invalidateSortedCollection();
+            population->updateSortedCollectionOfIndividuals();
+        }, make_population);
+        // Absolute fitness: value of tree, with results cached on Individual.
+        benchmark.run("evolutionStep/" + s, [&]()
+        {
+            population->evolutionStep([](Individual* i)
+            {
+                return std::any_cast<float>(i->treeValue());
+            });
+        }, make_population);
+        population = nullptr;
+    }
+    return EXIT_SUCCESS;
+}
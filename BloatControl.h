@@ -0,0 +1,220 @@
+//
+//  BloatControl.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Optional control of "bloat", the growth of GpTree size over a run, which
+// slows evaluation roughly in proportion to size. A Population has one
+// BloatControl, set at construction or with Population::setBloatControl().
+// Modes:
+//
+//   None: (default) crossover size bias only, see GpTree::crossoverBySize().
+//   SizeDepthLimit: reject offspring larger than maxSize() or deeper than
+//       maxDepth(), retry crossover, eventually use a copy of a parent.
+//   LexicographicParsimony: when tournament metrics are tied, the larger tree
+//       loses (Luke and Panait, 2002).
+//   Tarpeian: with likelihood tarpeianLikelihood(), a tournament containing
+//       an above average size tree designates it the loser without running
+//       the tournament function (Poli, 2003).
+//   OperatorEqualisation: offspring are accepted only if their size bin in a
+//       histogram of Population tree sizes is below its target count, retrying
+//       crossover otherwise (a simplified version of Dignum and Poli, 2008).
+//
+// Counts of the actions taken are kept in stats().
+
+#pragma once
+#include "TournamentGroup.h"
+
+class BloatControl
+{
+public:
+    enum Mode
+    {
+        None,
+        SizeDepthLimit,
+        LexicographicParsimony,
+        Tarpeian,
+        OperatorEqualisation
+    };
+    static const char* modeName(Mode mode)
+    {
+        static const char* names[] =
+        {
+            "none", "size_depth_limit", "lexicographic_parsimony",
+            "tarpeian", "operator_equalisation"
+        };
+        return names[mode];
+    }
+    // Counts of actions taken.
+    struct Stats
+    {
+        uint64_t offspring = 0;           // New offspring trees accepted.
+        uint64_t rejections = 0;          // Offspring rejected and retried.
+        uint64_t fallbacks = 0;           // Retries exhausted.
+        uint64_t parsimony_decisions = 0; // Losers chosen by size tie-break.
+        uint64_t tarpeian_removals = 0;   // Losers chosen by Tarpeian method.
+    };
+
+    BloatControl() {}
+    BloatControl(Mode mode) : mode_(mode) {}
+    Mode mode() const { return mode_; }
+
+    // Parameters, with defaults. A maxSize() of zero (the default) means use
+    // the Population's max crossover tree size.
+    int maxSize() const { return max_size_; }
+    void setMaxSize(int size) { max_size_ = size; }
+    int maxDepth() const { return max_depth_; }
+    void setMaxDepth(int depth) { max_depth_ = depth; }
+    int maxRetries() const { return max_retries_; }
+    void setMaxRetries(int retries) { max_retries_ = retries; }
+    float tarpeianLikelihood() const { return tarpeian_likelihood_; }
+    void setTarpeianLikelihood(float likelihood)
+        { tarpeian_likelihood_ = likelihood; }
+    // Width of size bins for OperatorEqualisation.
+    int binWidth() const { return bin_width_; }
+    void setBinWidth(int width) { bin_width_ = width; }
+    // Target fraction of Population in each size bin for OperatorEqualisation.
+    // If empty (default) it is uniform over sizes from 1 to maxSize().
+    void setTargetDistribution(const std::vector<float>& fractions)
+        { target_distribution_ = fractions; }
+
+    const Stats& stats() const { return stats_; }
+    void resetStats() { stats_ = Stats(); }
+    std::string statsString() const
+    {
+        std::stringstream ss;
+        ss << modeName(mode()) << ": offspring=" << stats_.offspring;
+        ss << " rejections=" << stats_.rejections;
+        ss << " fallbacks=" << stats_.fallbacks;
+        ss << " parsimony=" << stats_.parsimony_decisions;
+        ss << " tarpeian=" << stats_.tarpeian_removals;
+        return ss.str();
+    }
+
+    // Should offspring tree be accepted into Population? "population_max_size"
+    // is used when maxSize() is zero.
+    bool acceptOffspring(const GpTree& tree, int population_max_size)
+    {
+        bool ok = true;
+        int max_size = max_size_ ? max_size_ : population_max_size;
+        if (mode() == SizeDepthLimit)
+        {
+            ok = (tree.size() <= max_size) && (tree.depth() <= maxDepth());
+        }
+        if (mode() == OperatorEqualisation)
+        {
+            int bin = sizeBin(tree.size());
+            ok = histogram_.at(bin) < targetCount(bin, max_size);
+        }
+        if (ok) { stats_.offspring++; } else { stats_.rejections++; }
+        return ok;
+    }
+    // Called when no offspring is accepted after maxRetries(). Under
+    // SizeDepthLimit, the offspring is replaced by a copy of "parent".
+    void fallback(GpTree& offspring, const GpTree& parent)
+    {
+        stats_.fallbacks++;
+        stats_.offspring++;
+        if (mode() == SizeDepthLimit) { offspring = parent; }
+    }
+
+    // For Tarpeian mode: maybe designate an above average size member as loser
+    // of tournament. Returns true if so (and the tournament should be skipped).
+    bool tarpeian(TournamentGroup& group, float average_size)
+    {
+        bool removed = false;
+        if (mode() == Tarpeian)
+        {
+            Individual* largest = nullptr;
+            for (auto& m : group.members())
+            {
+                int size = m.individual->tree().size();
+                if ((size > average_size) &&
+                    (!largest || (size > largest->tree().size())))
+                {
+                    largest = m.individual;
+                }
+            }
+            if (largest && LPRS().randomBool(tarpeianLikelihood()))
+            {
+                group.designateWorstIndividual(largest);
+                stats_.tarpeian_removals++;
+                removed = true;
+            }
+        }
+        return removed;
+    }
+    // For LexicographicParsimony mode: break ties in metric by tree size.
+    void parsimony(TournamentGroup& group)
+    {
+        if (mode() == LexicographicParsimony)
+        {
+            Individual* loser = group.worstIndividual();
+            group.sortWithParsimony();
+            if (loser != group.worstIndividual()) stats_.parsimony_decisions++;
+        }
+    }
+
+    // For OperatorEqualisation mode: histogram of tree sizes in Population.
+    // Rebuilt by setHistogram(), updated incrementally by replaceInHistogram().
+    bool needsHistogram(int population_size) const
+    {
+        return (mode() == OperatorEqualisation) &&
+               (histogram_count_ != population_size);
+    }
+    void setHistogram(const std::vector<int>& tree_sizes)
+    {
+        histogram_.clear();
+        histogram_count_ = 0;
+        for (int size : tree_sizes) { addToHistogram(size, +1); }
+    }
+    void replaceInHistogram(int old_size, int new_size)
+    {
+        if (mode() == OperatorEqualisation)
+        {
+            addToHistogram(old_size, -1);
+            addToHistogram(new_size, +1);
+        }
+    }
+
+private:
+    int sizeBin(int size)
+    {
+        int bin = std::max(0, size - 1) / binWidth();
+        if (int(histogram_.size()) <= bin) histogram_.resize(bin + 1, 0);
+        return bin;
+    }
+    void addToHistogram(int size, int count)
+    {
+        histogram_.at(sizeBin(size)) += count;
+        histogram_count_ += count;
+    }
+    // Target number of trees in given bin, given population size and max size.
+    float targetCount(int bin, int max_size) const
+    {
+        float fraction = 0;
+        if (target_distribution_.empty())
+        {
+            int bins = 1 + std::max(0, max_size - 1) / binWidth();
+            fraction = (bin < bins) ? 1.0f / bins : 0;
+        }
+        else if (bin < int(target_distribution_.size()))
+        {
+            fraction = target_distribution_.at(bin);
+        }
+        return fraction * histogram_count_;
+    }
+    Mode mode_ = None;
+    int max_size_ = 0;
+    int max_depth_ = 17;
+    int max_retries_ = 10;
+    float tarpeian_likelihood_ = 0.3;
+    int bin_width_ = 5;
+    std::vector<float> target_distribution_;
+    std::vector<int> histogram_;
+    int histogram_count_ = 0;
+    Stats stats_;
+};
@@ -0,0 +1,235 @@
+//
+//  Coevolution.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Coevolution of several interacting Populations (for example predators and
+// prey), each with its own FunctionSet. An Individual's fitness is relative
+// to members of other Populations: in each tournament, each member meets
+// opponentCount() opponents sampled from each Population set as its opponent
+// with setEncounter(). Its metric for the tournament is its average score.
+//
+// Each step() advances all Populations together, in three phases:
+//   1. Select a tournament in each Population and sample opponents (serial).
+//   2. Run all encounters, in parallel on threadPool(). Each distinct tree is
+//      evaluated first, so encounters only read the cached tree values.
+//   3. Complete each Population's evolution step, in parallel. A Population
+//      changes only its own Individuals, and with its own LPRS() sequence
+//      (seeded from the global one in phase 1) so runs are repeatable.
+// EncounterFunctions (and Population loggers) must therefore be thread-safe.
+//
+// Each Population's evalBudget() applies to evaluations of its trees, and to
+// encounters scoring its members. An Individual whose evaluation is stopped
+// is recorded as over budget by its Population, and encounters involving it
+// are skipped. A stopped encounter is not scored, and its member is recorded
+// as over budget (under policy InvalidTournament, its tournament is canceled).
+
+#pragma once
+#include "Population.h"
+
+class Coevolution
+{
+public:
+    // Score of "individual" in an encounter with "opponent" (higher is
+    // better). Called concurrently from several threads.
+    typedef std::function<float(Individual* individual, Individual* opponent)>
+        EncounterFunction;
+
+    // Add a Population, owned by this Coevolution. Returns its index.
+    int addPopulation(std::unique_ptr<Population> population)
+    {
+        populations_.push_back(std::move(population));
+        encounters_.resize(populations_.size());
+        return populationCount() - 1;
+    }
+    Population& population(int p) { return *populations_.at(p); }
+    const Population& population(int p) const { return *populations_.at(p); }
+    int populationCount() const { return int(populations_.size()); }
+
+    // Members of Population "p" are judged by encounters, scored by
+    // "function", with opponents from Population "q". (May be called for
+    // several q, then scores against all are averaged.)
+    void setEncounter(int p, int q, EncounterFunction function)
+    {
+        assert((q >= 0) && (q < populationCount()));
+        encounters_.at(p).push_back({q, function});
+    }
+
+    // Opponents sampled from each opponent Population (default 5).
+    int opponentCount() const { return opponent_count_; }
+    void setOpponentCount(int count) { opponent_count_ = std::max(1, count); }
+
+    // Pool for parallel phases, ThreadPool::shared() unless set.
+    ThreadPool& threadPool() const
+    {
+        return thread_pool_ ? *thread_pool_ : ThreadPool::shared();
+    }
+    void setThreadPool(ThreadPool* pool) { thread_pool_ = pool; }
+
+    // Steps taken, and total encounters run.
+    int getStepCount() const { return step_count_; }
+    int64_t encounterCount() const { return encounter_count_; }
+
+    // Run "steps" steps.
+    void run(int steps) { for (int i = 0; i < steps; i++) { step(); } }
+
+    // Advance each Population (with at least one encounter) by one
+    // evolution step.
+    void step()
+    {
+        // Phase 1: select tournaments, sample opponents.
+        std::vector<Tournament> tournaments;
+        std::vector<Encounter> encounters;
+        for (int p = 0; p < populationCount(); p++)
+        {
+            if (encounters_.at(p).empty()) continue;
+            Population& population = *populations_[p];
+            Population::SubPop& subpop = population.currentSubpopulation();
+            tournaments.push_back({p, &subpop,
+                                   population.randomTournamentGroup(subpop),
+                                   LPRS().nextInt()});
+            for (auto& member : tournaments.back().group.members())
+            {
+                // An Individual over its EvalBudget will lose anyway.
+                if (member.individual->overBudget()) continue;
+                for (auto& [q, function] : encounters_.at(p))
+                {
+                    for (int i = 0; i < opponent_count_; i++)
+                    {
+                        Individual* opponent = randomOpponent(q);
+                        if (!opponent) continue;
+                        encounters.push_back({member.individual, opponent,
+                                              p, q, &function});
+                    }
+                }
+            }
+        }
+        // Phase 2: evaluate each distinct tree, then run encounters, each
+        // within the EvalBudget of the Population it belongs to.
+        std::map<Individual*, int> owners;
+        for (auto& e : encounters)
+        {
+            owners[e.individual] = e.population;
+            owners[e.opponent] = e.opponent_population;
+        }
+        std::vector<std::pair<Individual*, int>> participants(owners.begin(),
+                                                              owners.end());
+        std::vector<uint8_t> evaluated(participants.size(), false);
+        threadPool().parallelFor(0, int(participants.size()), [&](int i)
+        {
+            auto [individual, p] = participants[i];
+            evaluated[i] = populations_[p]->runWithinEvalBudget([&]()
+                { individual->treeValue(); });
+        });
+        std::set<Individual*> stopped;
+        for (size_t i = 0; i < participants.size(); i++)
+        {
+            if (evaluated[i]) continue;
+            auto [individual, p] = participants[i];
+            populations_[p]->recordOverBudget(individual);
+            stopped.insert(individual);
+        }
+        threadPool().parallelFor(0, int(encounters.size()), [&](int i)
+        {
+            Encounter& e = encounters[i];
+            if (stopped.count(e.individual) || stopped.count(e.opponent))
+            {
+                return;
+            }
+            e.completed = populations_[e.population]->runWithinEvalBudget([&]()
+                { e.score = (*e.function)(e.individual, e.opponent); });
+            e.stopped = !e.completed;
+        });
+        encounter_count_ += encounters.size();
+        // Average score of each tournament member over completed encounters.
+        std::map<Individual*, std::pair<double, int>> totals;
+        for (auto& e : encounters)
+        {
+            if (e.stopped)
+            {
+                populations_[e.population]->recordOverBudget(e.individual);
+                stopped.insert(e.individual);
+            }
+            if (!e.completed) continue;
+            totals[e.individual].first += e.score;
+            totals[e.individual].second++;
+        }
+        auto average_score = [&](Individual* individual)
+        {
+            auto it = totals.find(individual);
+            return ((it == totals.end()) ? 0.0f :
+                    float(it->second.first / it->second.second));
+        };
+        // Phase 3: complete evolution steps.
+        threadPool().parallelFor(0, int(tournaments.size()), [&](int t)
+        {
+            Tournament& tournament = tournaments[t];
+            LP::LocalRandomSequence random(tournament.seed);
+            Population& population = *populations_[tournament.population];
+            bool cancel_if_stopped = (population.evalBudget().policy() ==
+                                      EvalBudget::InvalidTournament);
+            population.evolutionStep
+                (tournament.group,
+                 *tournament.subpop,
+                 [&](TournamentGroup group)
+                 {
+                     group.setAllMetrics(average_score);
+                     for (auto& member : group.members())
+                     {
+                         if (cancel_if_stopped &&
+                             stopped.count(member.individual))
+                         {
+                             group.setValid(false);
+                         }
+                     }
+                     return group;
+                 });
+        });
+        step_count_++;
+    }
+
+private:
+    struct Tournament
+    {
+        int population;
+        Population::SubPop* subpop;
+        TournamentGroup group;
+        uint64_t seed;
+    };
+    struct Encounter
+    {
+        Individual* individual;
+        Individual* opponent;
+        int population;           // Of individual.
+        int opponent_population;
+        const EncounterFunction* function;
+        float score = 0;
+        bool completed = false;   // Run, and not stopped by EvalBudget.
+        bool stopped = false;
+    };
+    // Random Individual of Population "q", not over its EvalBudget (or
+    // nullptr if none found after a few tries).
+    Individual* randomOpponent(int q)
+    {
+        Population& population = *populations_.at(q);
+        for (int tries = 0; tries < 10; tries++)
+        {
+            int s = LPRS().randomN(population.getSubpopulationCount());
+            Population::SubPop& subpop = population.subpopulation(s);
+            Individual* opponent = subpop.at(population.
+                                             randomIndividualIndex(subpop));
+            if (!opponent->overBudget()) { return opponent; }
+        }
+        return nullptr;
+    }
+    std::vector<std::unique_ptr<Population>> populations_;
+    // For each Population: (opponent Population, EncounterFunction) pairs.
+    std::vector<std::vector<std::pair<int, EncounterFunction>>> encounters_;
+    int opponent_count_ = 5;
+    ThreadPool* thread_pool_ = nullptr;
+    int step_count_ = 0;
+    int64_t encounter_count_ = 0;
+};
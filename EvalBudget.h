@@ -0,0 +1,173 @@
+//
+//  EvalBudget.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Limits on the work done by one evaluation (a tree eval, fitness function,
+// or tournament function): a maximum number of GpFunction nodes evaluated and
+// a maximum wall clock time. So one pathological program cannot stall a run.
+//
+// EvalBudget::run() makes a budget "current" on its thread while running an
+// evaluation. GpTree::eval() calls checkpoint() before each GpFunction node,
+// which stops the evaluation if the budget is exceeded or cancel() was called
+// (from any thread). Copies of an EvalBudget share cancellation, so cancel()
+// stops the current run() of each copy, such as those Population makes from
+// its evalBudget() for each evaluation. The time limit is checked before every
+// node, or every timeCheckInterval() nodes if set higher to save clock reads.
+// A GpFunction with a long internal loop can poll shouldStop() and return
+// early with any value of its type, which will be discarded. Stopping unwinds
+// from checkpoint() back to run() by throwing a private exception type, so
+// values made by GpFunctions during the stopped evaluation may leak unless
+// they are cached in the GpTree. run() returns false when the evaluation was
+// stopped.
+//
+// policy() says what Population does with an over-budget evaluation, see
+// Population::setEvalBudget().
+
+#pragma once
+#include "Utilities.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+class EvalBudget
+{
+public:
+    // What Population does when an Individual's evaluation is over budget:
+    //   WorstFitness: it loses its tournament (its fitness is set to lowest).
+    //   InvalidTournament: the tournament is canceled, see setValid(false).
+    enum Policy { WorstFitness, InvalidTournament };
+    typedef std::chrono::steady_clock Clock;
+
+    EvalBudget() {}
+    EvalBudget(int max_nodes, double max_seconds, Policy policy = WorstFitness)
+      : max_nodes_(max_nodes), max_seconds_(max_seconds), policy_(policy) {}
+    // Copies share cancellation (but not counts of nodes or stops).
+    EvalBudget(const EvalBudget& other)
+      : EvalBudget(other.maxNodes(), other.maxSeconds(), other.policy())
+    {
+        time_check_interval_ = other.timeCheckInterval();
+        cancellations_ = other.cancellations_;
+    }
+    EvalBudget& operator=(const EvalBudget& other)
+    {
+        max_nodes_ = other.maxNodes();
+        max_seconds_ = other.maxSeconds();
+        policy_ = other.policy();
+        time_check_interval_ = other.timeCheckInterval();
+        cancellations_ = other.cancellations_;
+        return *this;
+    }
+
+    // Limits, zero (the default) means unlimited.
+    int maxNodes() const { return max_nodes_; }
+    void setMaxNodes(int nodes) { max_nodes_ = nodes; }
+    double maxSeconds() const { return max_seconds_; }
+    void setMaxSeconds(double seconds) { max_seconds_ = seconds; }
+    // Is either limit set?
+    bool limited() const { return (max_nodes_ > 0) || (max_seconds_ > 0); }
+    Policy policy() const { return policy_; }
+    void setPolicy(Policy policy) { policy_ = policy; }
+    // Read the clock for the time limit every this many nodes (default 1).
+    int timeCheckInterval() const { return time_check_interval_; }
+    void setTimeCheckInterval(int nodes)
+    {
+        assert(nodes > 0);
+        time_check_interval_ = nodes;
+    }
+
+    // Run an evaluation within this budget. Returns false if it was stopped.
+    // Other exceptions pass through, after the previous budget is restored.
+    bool run(const std::function<void()>& evaluation)
+    {
+        MakeCurrent make_current(this);
+        nodes_ = 0;
+        start_time_ = Clock::now();
+        start_cancellations_ = *cancellations_;
+        bool completed = true;
+        try { evaluation(); }
+        catch (const Stopped&) { completed = false; }
+        // Also stopped if over budget at end (say a GpFunction at root
+        // returned early because of shouldStop()).
+        if (overBudget(true)) { completed = false; }
+        if (!completed) { stopped_count_++; }
+        return completed;
+    }
+
+    // Cancellation token: stop the current run() of this budget, and of its
+    // copies. Later runs are not affected. May be called from any thread.
+    void cancel() const { (*cancellations_)++; }
+    // Was the most recent run() cancelled?
+    bool cancelled() const { return *cancellations_ != start_cancellations_; }
+    // Nodes evaluated and seconds elapsed in the most recent run().
+    int nodes() const { return nodes_; }
+    double seconds() const
+    {
+        return std::chrono::duration<double>(Clock::now() -
+                                             start_time_).count();
+    }
+    // Number of evaluations stopped by this budget.
+    int stoppedCount() const { return stopped_count_; }
+
+    // The budget of the evaluation running on this thread, or nullptr.
+    static EvalBudget* current() { return current_; }
+    // Called by GpTree::eval() before each GpFunction node. Counts the node,
+    // stops the evaluation if over budget. The clock is read every
+    // timeCheckInterval() nodes.
+    static void checkpoint()
+    {
+        EvalBudget* budget = current_;
+        if (budget)
+        {
+            budget->nodes_++;
+            int interval = budget->time_check_interval_;
+            bool check_time = ((interval == 1) ||
+                               ((budget->nodes_ % interval) == 0));
+            if (budget->overBudget(check_time)) { throw Stopped(); }
+        }
+    }
+    // For use in GpFunction implementations with long running loops: should
+    // the current evaluation stop? (Reads the clock on each call.)
+    static bool shouldStop()
+    {
+        EvalBudget* budget = current_;
+        return budget && budget->overBudget(true);
+    }
+
+private:
+    // Thrown by checkpoint(), caught by run().
+    struct Stopped {};
+    // Makes a budget current for its lifetime, then restores the previous
+    // one, even when an exception unwinds through run().
+    class MakeCurrent
+    {
+    public:
+        MakeCurrent(EvalBudget* budget) : previous_(current_)
+            { current_ = budget; }
+        ~MakeCurrent() { current_ = previous_; }
+    private:
+        EvalBudget* previous_;
+    };
+    bool overBudget(bool check_time) const
+    {
+        bool time_limited = check_time && (max_seconds_ > 0);
+        return (cancelled() ||
+                ((max_nodes_ > 0) && (nodes_ > max_nodes_)) ||
+                (time_limited && (seconds() > max_seconds_)));
+    }
+    int max_nodes_ = 0;
+    double max_seconds_ = 0;
+    Policy policy_ = WorstFitness;
+    int time_check_interval_ = 1;
+    int nodes_ = 0;
+    Clock::time_point start_time_;
+    // Count of cancel() calls, shared by copies, and its value at run().
+    std::shared_ptr<std::atomic<uint64_t>> cancellations_ =
+        std::make_shared<std::atomic<uint64_t>>(0);
+    uint64_t start_cancellations_ = 0;
+    int stopped_count_ = 0;
+    static inline thread_local EvalBudget* current_ = nullptr;
+};
@@ -0,0 +1,200 @@
+//
+//  EvalPlan.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// An EvalPlan is compiled from a GpTree for repeated evaluation, for example
+// once per fitness case where some GpFunctions read the current case. The
+// GpTree itself (the genotype, used for crossover) is not changed. Subtrees
+// whose root GpFunction is pure or foldable (see GpFunction::pure() and
+// GpFunction::foldable()) are optimized:
+//
+//   Constant folding: a foldable (and pure) function with parameters, which
+//       are all constant, is evaluated once, at compile time, and replaced by
+//       its value. A pure function which reads the current fitness case is
+//       not folded, even when its parameters are constant.
+//   Common subexpression elimination: identical pure subtrees (same function
+//       applied to the same inputs) are merged into one step of a DAG, which
+//       is evaluated once per eval().
+//
+// Leaf constants are considered identical when their GpType's identityString()
+// is the same. The plan is a sequence of steps in dependency order. Each step
+// calls its GpFunction via a small "shim" GpTree whose subtrees are leaves
+// holding the values of the step's inputs. Values of GpTypes with a deleter,
+// made by the plan, are deleted when replaced and when the plan is destroyed.
+
+#pragma once
+#include "GpTree.h"
+
+class EvalPlan
+{
+public:
+    EvalPlan(){}
+    EvalPlan(const GpTree& gp_tree)
+    {
+        tree_size_ = gp_tree.size();
+        root_ = compile(gp_tree);
+        for (auto& step : steps_) if (!step.constant) execution_count_++;
+    }
+    ~EvalPlan()
+    {
+        for (auto& step : steps_) deleteValue(step);
+    }
+    EvalPlan(EvalPlan&&) = default;
+    EvalPlan& operator=(EvalPlan&& other)
+    {
+        if (this != &other)
+        {
+            // Delete values owned by this plan before taking other's steps.
+            for (auto& step : steps_) deleteValue(step);
+            steps_ = std::move(other.steps_);
+            other.steps_.clear();
+            root_ = other.root_;
+            tree_size_ = other.tree_size_;
+            execution_count_ = other.execution_count_;
+            folded_count_ = other.folded_count_;
+            merged_count_ = other.merged_count_;
+            expressions_ = std::move(other.expressions_);
+            constants_ = std::move(other.constants_);
+        }
+        return *this;
+    }
+    EvalPlan(const EvalPlan&) = delete;
+    EvalPlan& operator=(const EvalPlan&) = delete;
+
+    // Evaluate plan, returns value of the GpTree's root.
+    std::any eval()
+    {
+        for (auto& step : steps_)
+        {
+            if (!step.constant)
+            {
+                for (size_t i = 0; i < step.inputs.size(); i++)
+                {
+                    const Step& input = steps_.at(step.inputs.at(i));
+                    GpTree& leaf = step.shim.getSubtree(i);
+                    leaf.setRootValue(value(input), *input.type);
+                }
+                deleteValue(step);
+                step.shim.eval();
+            }
+        }
+        return value(steps_.at(root_));
+    }
+
+    // Number of nodes in the original GpTree.
+    int treeSize() const { return tree_size_; }
+    // Number of GpFunction calls made by each eval().
+    int executionCount() const { return execution_count_; }
+    // Number of GpFunction calls removed by constant folding, and number of
+    // steps merged by common subexpression elimination.
+    int foldedCount() const { return folded_count_; }
+    int mergedCount() const { return merged_count_; }
+
+private:
+    struct Step
+    {
+        const GpType* type = nullptr;
+        // For constants, a leaf holding the value. For function calls, the
+        // GpFunction at root, with a leaf subtree for each input.
+        GpTree shim;
+        bool constant = true;
+        // Does this plan own (and so delete) the value?
+        bool owned = false;
+        std::vector<int> inputs;  // Indices of input steps.
+    };
+    // Add steps to evaluate "tree", returns index of its root's step.
+    int compile(const GpTree& tree)
+    {
+        if (tree.isLeaf())
+        {
+            return addConstant(tree.getRootValue(), *tree.getRootType(), false);
+        }
+        const GpFunction& function = tree.getRootFunction();
+        std::vector<int> inputs;
+        bool all_constant = true;
+        for (auto& subtree : tree.subtrees())
+        {
+            inputs.push_back(compile(subtree));
+            all_constant = all_constant && steps_.at(inputs.back()).constant;
+        }
+        Step step;
+        step.type = function.returnType();
+        step.constant = false;
+        step.owned = true;
+        step.inputs = inputs;
+        step.shim.setRootFunction(function);
+        step.shim.addSubtrees(inputs.size());
+        if (function.pure() && function.foldable() &&
+            all_constant && !inputs.empty())
+        {
+            // Constant folding: evaluate now, replace with resulting value.
+            for (size_t i = 0; i < inputs.size(); i++)
+            {
+                const Step& input = steps_.at(inputs.at(i));
+                step.shim.getSubtree(i).setRootValue(value(input),
+                                                     *input.type);
+            }
+            folded_count_++;
+            return addConstant(step.shim.eval(), *step.type, true);
+        }
+        if (function.pure())
+        {
+            // Common subexpression: reuse step for same function and inputs.
+            auto key = std::make_pair(&function, inputs);
+            auto it = expressions_.find(key);
+            if (it != expressions_.end())
+            {
+                merged_count_++;
+                return it->second;
+            }
+            expressions_[key] = int(steps_.size());
+        }
+        steps_.push_back(std::move(step));
+        return int(steps_.size()) - 1;
+    }
+    // Add a constant step (or reuse one with identical value and type).
+    int addConstant(std::any value, const GpType& type, bool owned)
+    {
+        std::string text;
+        bool shareable = type.hasToString() && !type.hasDeleter();
+        if (shareable)
+        {
+            text = type.identityString(value);
+            auto it = constants_.find({&type, text});
+            if (it != constants_.end()) { return it->second; }
+            constants_[{&type, text}] = int(steps_.size());
+        }
+        Step step;
+        step.type = &type;
+        step.owned = owned;
+        step.shim.setRootValue(value, type);
+        steps_.push_back(std::move(step));
+        return int(steps_.size()) - 1;
+    }
+    static std::any value(const Step& step)
+    {
+        return step.shim.getRootValue();
+    }
+    // Delete value of a step, if owned and its type has a deleter.
+    static void deleteValue(Step& step)
+    {
+        std::any value = step.shim.getRootValue();
+        if (step.owned && step.type->hasDeleter() && value.has_value())
+        {
+            step.type->deleteValue(value);
+            step.shim.setRootValue(std::any(), *step.type);
+        }
+    }
+    std::vector<Step> steps_;
+    int root_ = 0;
+    int tree_size_ = 0;
+    int execution_count_ = 0;
+    int folded_count_ = 0;
+    int merged_count_ = 0;
+    std::map<std::pair<const GpFunction*, std::vector<int>>, int> expressions_;
+    std::map<std::pair<const GpType*, std::string>, int> constants_;
+};
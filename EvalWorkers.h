@@ -0,0 +1,653 @@
+//
+//  EvalWorkers.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// A pool of forked worker processes for evaluating fitness. Intended for
+// fitness functions which are not thread safe (say, a legacy library with
+// global state) and for isolating crashes: if an evaluation kills its worker
+// (segfault, abort) only that evaluation fails, then the worker is replaced.
+//
+// Each worker is forked from the calling process, so it has a copy of the
+// FunctionSet and the evaluation function. GpTrees are sent to a worker, as
+// WireFormat messages, through a SharedRing (a ring buffer in memory shared
+// between the two processes). Results return the same way. A socket pair
+// carries one byte "doorbells" to wake the other side, and reports a worker's
+// death as end of file.
+//
+// The evaluation function takes a "job", a group of one or more GpTrees, and
+// returns one float metric per tree. That is either a per-tree fitness, or the
+// tournament metrics of a group (see TournamentGroup::setAllMetrics()). An
+// EvalWorkers is used from one thread at a time. Requires POSIX (fork, mmap).
+//
+// An exception thrown in a worker ends it, like a crash. Failures to make a
+// worker (mmap, socketpair, fork) throw std::runtime_error, as do fitness()
+// and tournamentFunction() for a job, or its response, too large for a ring.
+//
+// Forking a multithreaded process is unsafe: a thread may hold a lock (such as
+// malloc's) which then stays locked forever in the child. So the constructor
+// forks once, to start a single threaded "fork server" which then forks every
+// worker, including replacements for crashed ones. Make an EvalWorkers before
+// starting other threads (such as a ThreadPool, see ThreadPool::shared()).
+// Workers see the state of this process as of construction.
+
+#pragma once
+#include "Population.h"
+#include "WireFormat.h"
+#include <atomic>
+#include <cstring>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Single producer single consumer ring buffer of messages (std::strings) in
+// memory shared between processes, mapped before fork().
+class SharedRing
+{
+public:
+    SharedRing(size_t capacity) : capacity_(capacity)
+    {
+        static_assert(std::atomic<uint64_t>::is_always_lock_free);
+        bytes_ = sizeof(Header) + capacity_;
+        void* memory = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            throw std::runtime_error(std::string("SharedRing mmap() failed: ")
+                                     + std::strerror(errno));
+        }
+        header_ = new (memory) Header;
+        data_ = static_cast<char*>(memory) + sizeof(Header);
+    }
+    ~SharedRing() { munmap(header_, bytes_); }
+    SharedRing(const SharedRing&) = delete;
+    SharedRing& operator=(const SharedRing&) = delete;
+    // Add message to ring, returns false if there is not room for it.
+    bool push(const std::string& message)
+    {
+        uint64_t head = header_->head.load(std::memory_order_relaxed);
+        uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        uint32_t size = uint32_t(message.size());
+        if (sizeof(size) + size > capacity_ - (head - tail)) return false;
+        copyIn(head, &size, sizeof(size));
+        copyIn(head + sizeof(size), message.data(), size);
+        header_->head.store(head + sizeof(size) + size,
+                            std::memory_order_release);
+        return true;
+    }
+    // Remove oldest message from ring, returns false if ring was empty.
+    bool pop(std::string& message)
+    {
+        uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (head == tail) return false;
+        uint32_t size = 0;
+        copyOut(tail, &size, sizeof(size));
+        message.resize(size);
+        copyOut(tail + sizeof(size), message.data(), size);
+        header_->tail.store(tail + sizeof(size) + size,
+                            std::memory_order_release);
+        return true;
+    }
+    // Discard all messages. Only when no other process is using the ring.
+    void reset()
+    {
+        header_->head.store(0);
+        header_->tail.store(0);
+    }
+    size_t capacity() const { return capacity_; }
+private:
+    // Total bytes ever written (head) and read (tail).
+    struct Header
+    {
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> tail{0};
+    };
+    void copyIn(uint64_t position, const void* source, size_t size)
+    {
+        const char* bytes = static_cast<const char*>(source);
+        for (size_t i = 0; i < size; i++)
+        {
+            data_[(position + i) % capacity_] = bytes[i];
+        }
+    }
+    void copyOut(uint64_t position, void* destination, size_t size) const
+    {
+        char* bytes = static_cast<char*>(destination);
+        for (size_t i = 0; i < size; i++)
+        {
+            bytes[i] = data_[(position + i) % capacity_];
+        }
+    }
+    size_t capacity_ = 0;
+    size_t bytes_ = 0;
+    Header* header_ = nullptr;
+    char* data_ = nullptr;
+};
+
+class EvalWorkers
+{
+public:
+    // Per-tree fitness function, and group ("tournament") metric function.
+    typedef std::function<float(GpTree&)> FitnessFunction;
+    typedef std::function<std::vector<float>(std::vector<GpTree>&)>
+        GroupFunction;
+    // Result of one job: a metric per tree, or ok == false if it crashed (or
+    // failed for another reason, described by "error").
+    struct Result
+    {
+        std::vector<float> metrics;
+        bool ok = false;
+        bool crashed = false;
+        std::string error;
+    };
+
+    // Fork "worker_count" workers which call a per-tree fitness function.
+    EvalWorkers(const FunctionSet& function_set,
+                int worker_count,
+                FitnessFunction fitness_function,
+                size_t ring_capacity = 1 << 20)
+      : EvalWorkers(function_set,
+                    worker_count,
+                    [fitness_function](std::vector<GpTree>& trees)
+                    {
+                        std::vector<float> metrics;
+                        for (auto& tree : trees)
+                        {
+                            metrics.push_back(fitness_function(tree));
+                        }
+                        return metrics;
+                    },
+                    ring_capacity)
+    {
+        per_tree_ = true;
+    }
+    // Fork "worker_count" workers which call a group metric function.
+    EvalWorkers(const FunctionSet& function_set,
+                int worker_count,
+                GroupFunction group_function,
+                size_t ring_capacity = 1 << 20)
+      : function_set_(function_set), group_function_(group_function)
+    {
+        assert(worker_count > 0);
+        try
+        {
+            for (int i = 0; i < worker_count; i++)
+            {
+                slots_.push_back(std::make_unique<Slot>(ring_capacity, i));
+            }
+            startServer();
+            for (auto& slot : slots_) { spawn(*slot); }
+        }
+        catch (...) { shutdown(); throw; }
+    }
+    ~EvalWorkers() { shutdown(); }
+    EvalWorkers(const EvalWorkers&) = delete;
+    EvalWorkers& operator=(const EvalWorkers&) = delete;
+
+    // Evaluate each job (group of trees) on some worker, in parallel. Returns
+    // results in same order as jobs.
+    std::vector<Result> evaluate(const std::vector<std::vector<const GpTree*>>&
+                                 jobs)
+    {
+        std::vector<Result> results(jobs.size());
+        size_t next = 0;
+        int busy = 0;
+        try
+        {
+            while ((next < jobs.size()) || (busy > 0))
+            {
+                // Give a job to each idle worker.
+                for (auto& slot : slots_)
+                {
+                    if ((slot->job < 0) && (next < jobs.size()))
+                    {
+                        if (send(*slot, jobs.at(next)))
+                        {
+                            slot->job = int(next);
+                            busy++;
+                        }
+                        else
+                        {
+                            results.at(next).error = "job too large for ring";
+                        }
+                        next++;
+                    }
+                }
+                // Wait for a worker to finish (or die).
+                std::vector<pollfd> fds;
+                std::vector<Slot*> polled;
+                for (auto& slot : slots_)
+                {
+                    if (slot->job < 0) continue;
+                    fds.push_back({slot->socket, POLLIN, 0});
+                    polled.push_back(slot.get());
+                }
+                if (fds.empty()) continue;
+                while (poll(fds.data(), fds.size(), -1) < 0)
+                {
+                    if (errno != EINTR) { throwError("poll()"); }
+                }
+                for (size_t i = 0; i < fds.size(); i++)
+                {
+                    if (!fds.at(i).revents) continue;
+                    Slot& slot = *polled.at(i);
+                    receive(slot, results.at(slot.job));
+                    slot.job = -1;
+                    busy--;
+                }
+            }
+        }
+        catch (...)
+        {
+            // Abandon jobs in progress: stop their workers, which are
+            // replaced by the next send().
+            for (auto& slot : slots_)
+            {
+                if (slot->job < 0) continue;
+                if (slot->pid > 0) { kill(slot->pid, SIGKILL); }
+                if (slot->socket >= 0) { close(slot->socket); }
+                slot->socket = -1;
+                slot->pid = -1;
+                slot->job = -1;
+            }
+            throw;
+        }
+        return results;
+    }
+
+    // Fitness of each tree (each a separate job). A crashed evaluation gets
+    // failureMetric(), other failures throw std::runtime_error.
+    std::vector<float> fitness(const std::vector<const GpTree*>& trees)
+    {
+        std::vector<std::vector<const GpTree*>> jobs;
+        for (auto tree : trees) { jobs.push_back({tree}); }
+        std::vector<float> fitnesses;
+        for (auto& result : evaluate(jobs))
+        {
+            fitnesses.push_back(metric(result, 0));
+        }
+        return fitnesses;
+    }
+
+    // A TournamentFunction for Population::evolutionStep(). With a per-tree
+    // fitness function, evaluates (in parallel) members without a cached
+    // fitness, then caches it on them. With a group function, evaluates the
+    // whole group as one job. Crashed evaluations get failureMetric(), other
+    // failures throw std::runtime_error.
+    Population::TournamentFunction tournamentFunction(Population& population)
+    {
+        return [this, &population](TournamentGroup group)
+        {
+            if (per_tree_)
+            {
+                std::vector<Individual*> individuals;
+                std::vector<const GpTree*> trees;
+                for (auto& member : group.members())
+                {
+                    if (member.individual->hasFitness()) continue;
+                    individuals.push_back(member.individual);
+                    trees.push_back(&member.individual->tree());
+                }
+                std::vector<float> fitnesses = fitness(trees);
+                for (size_t i = 0; i < individuals.size(); i++)
+                {
+                    individuals.at(i)->setFitness(fitnesses.at(i));
+                }
+                if (!trees.empty()) { population.invalidateSortedCollection(); }
+                group.setAllMetrics([](Individual* individual)
+                                    { return individual->getFitness(); });
+            }
+            else
+            {
+                std::vector<const GpTree*> trees;
+                for (auto& member : group.members())
+                {
+                    trees.push_back(&member.individual->tree());
+                }
+                Result result = evaluate({trees}).at(0);
+                std::vector<TournamentGroupMember> members = group.members();
+                for (size_t i = 0; i < members.size(); i++)
+                {
+                    members.at(i).metric = metric(result, i);
+                }
+                bool valid = group.getValid();
+                group = TournamentGroup(members);  // Sorts by metric.
+                group.setValid(valid);
+            }
+            return group;
+        };
+    }
+
+    // Metric given to an evaluation which crashed its worker.
+    float failureMetric() const { return failure_metric_; }
+    void setFailureMetric(float metric) { failure_metric_ = metric; }
+    int workerCount() const { return int(slots_.size()); }
+    // Number of jobs completed, and of workers which exited abnormally
+    // (crashed, or ended by an exception).
+    int evaluations() const { return evaluations_; }
+    int crashes() const { return crashes_; }
+
+private:
+    // One worker process, and the rings and socket used to talk with it.
+    struct Slot
+    {
+        Slot(size_t capacity, int index_)
+          : requests(capacity), responses(capacity), index(index_) {}
+        SharedRing requests;
+        SharedRing responses;
+        int index = 0;    // Position in slots_.
+        int socket = -1;  // Parent's end of socket pair.
+        pid_t pid = -1;
+        int job = -1;     // Index of job in progress, or -1 if idle.
+    };
+    // Reply from fork server: pid of new worker, or -1 and errno.
+    struct ServerReply
+    {
+        int32_t pid = -1;
+        int32_t error = 0;
+    };
+
+    // Metric "i" of a Result: failureMetric() if crashed, throws if failed
+    // for another reason.
+    float metric(const Result& result, size_t i) const
+    {
+        if (result.ok) { return result.metrics.at(i); }
+        if (result.crashed) { return failureMetric(); }
+        throw std::runtime_error("EvalWorkers: " + result.error);
+    }
+    // Fork the fork server, which has a copy of slots_ and runs serverLoop().
+    void startServer()
+    {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+        {
+            throwError("socketpair()");
+        }
+        noSigPipe(sockets[0]);
+        std::cout << std::flush;
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            int error = errno;
+            close(sockets[0]);
+            close(sockets[1]);
+            errno = error;
+            throwError("fork()");
+        }
+        if (pid == 0)
+        {
+            // In fork server. An exception must not unwind into the parent's
+            // code, so ends the server.
+            try
+            {
+                close(sockets[0]);
+                serverLoop(sockets[1]);
+            }
+            catch (...) { _exit(1); }
+            _exit(0);
+        }
+        close(sockets[1]);
+        server_pid_ = pid;
+        server_socket_ = sockets[0];
+    }
+    // Ask fork server for a new worker process for slot. Throws
+    // std::runtime_error on failure.
+    void spawn(Slot& slot)
+    {
+        slot.requests.reset();
+        slot.responses.reset();
+        int32_t index = slot.index;
+        ServerReply reply;
+        int socket = -1;
+        if ((::send(server_socket_, &index, sizeof(index), sendFlags()) !=
+             sizeof(index)) ||
+            !receiveReply(server_socket_, reply, socket))
+        {
+            throw std::runtime_error("EvalWorkers fork server exited");
+        }
+        if (reply.pid < 0)
+        {
+            errno = reply.error;
+            throwError("fork()");
+        }
+        slot.pid = reply.pid;
+        slot.socket = socket;
+    }
+    // Replace the worker for slot, counting a crash if it exited abnormally.
+    void respawn(Slot& slot, bool crashed)
+    {
+        if (slot.socket >= 0) { close(slot.socket); }
+        slot.socket = -1;
+        slot.pid = -1;
+        if (crashed) { crashes_++; }
+        spawn(slot);
+    }
+    // Close connections to workers, which then exit, and to the fork server,
+    // which exits after its workers. Wait for it.
+    void shutdown()
+    {
+        for (auto& slot : slots_)
+        {
+            if (slot->socket >= 0) { close(slot->socket); }
+            slot->socket = -1;
+            slot->pid = -1;
+        }
+        if (server_socket_ >= 0) { close(server_socket_); }
+        server_socket_ = -1;
+        if (server_pid_ > 0) { waitpid(server_pid_, nullptr, 0); }
+        server_pid_ = -1;
+    }
+    // Body of fork server process: for each slot index read from "control"
+    // fork a worker, and reply with its pid and (via SCM_RIGHTS) the parent's
+    // end of its socket pair. When the parent closes "control", wait for all
+    // workers to exit. Exited workers are reaped on each request.
+    void serverLoop(int control)
+    {
+        int32_t index = 0;
+        while (::read(control, &index, sizeof(index)) == sizeof(index))
+        {
+            while (waitpid(-1, nullptr, WNOHANG) > 0) {}
+            ServerReply reply;
+            int sockets[2] = {-1, -1};
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+            {
+                reply.error = errno;
+            }
+            else
+            {
+                noSigPipe(sockets[0]);
+                noSigPipe(sockets[1]);
+                pid_t pid = fork();
+                if (pid == 0)
+                {
+                    // In worker. As above, an exception ends the worker.
+                    try
+                    {
+                        close(control);
+                        close(sockets[0]);
+                        workerLoop(*slots_.at(index), sockets[1]);
+                    }
+                    catch (...) { _exit(1); }
+                    _exit(0);
+                }
+                reply.pid = pid;
+                reply.error = (pid < 0) ? errno : 0;
+                close(sockets[1]);
+            }
+            sendReply(control, reply, (reply.pid > 0) ? sockets[0] : -1);
+            if (sockets[0] >= 0) { close(sockets[0]); }
+        }
+        while ((wait(nullptr) > 0) || (errno == EINTR)) {}
+    }
+    // Body of worker process: wait for doorbell, evaluate queued jobs, reply.
+    void workerLoop(Slot& slot, int socket)
+    {
+        char doorbell = 0;
+        std::string request;
+        while (::read(socket, &doorbell, 1) == 1)
+        {
+            while (slot.requests.pop(request))
+            {
+                WireReader reader(request);
+                int count = reader.read<int32_t>();
+                std::vector<GpTree> trees(std::max(0, count));
+                for (auto& tree : trees)
+                {
+                    reader.readTree(function_set_, tree);
+                }
+                WireWriter writer;
+                if (reader.ok())
+                {
+                    std::vector<float> metrics = group_function_(trees);
+                    for (auto& tree : trees) { tree.deleteCachedValues(); }
+                    writer.write(int32_t(metrics.size()));
+                    for (float metric : metrics) { writer.write(metric); }
+                }
+                else
+                {
+                    writer.write(int32_t(unreadableJob));
+                }
+                if (!slot.responses.push(writer.message()))
+                {
+                    WireWriter too_large;
+                    too_large.write(int32_t(responseTooLarge));
+                    slot.responses.push(too_large.message());
+                }
+                if (::send(socket, &doorbell, 1, sendFlags()) != 1) return;
+            }
+        }
+    }
+    // Send job to worker, returns false if it does not fit in the ring. (If
+    // the worker has died, receive() will find its socket closed.)
+    bool send(Slot& slot, const std::vector<const GpTree*>& trees)
+    {
+        // Replace a worker which was stopped (or not made). An idle worker
+        // never writes, so a readable socket means it died while idle.
+        pollfd idle = {slot.socket, POLLIN, 0};
+        if (slot.pid <= 0) { respawn(slot, false); }
+        else if (poll(&idle, 1, 0) > 0) { respawn(slot, true); }
+        WireWriter writer;
+        writer.write(int32_t(trees.size()));
+        for (auto tree : trees) { writer.writeTree(*tree); }
+        if (!slot.requests.push(writer.message())) { return false; }
+        char doorbell = 0;
+        ::send(slot.socket, &doorbell, 1, sendFlags());
+        return true;
+    }
+    // Read result from worker, or note its death and replace it.
+    void receive(Slot& slot, Result& result)
+    {
+        char doorbell = 0;
+        std::string response;
+        if ((::read(slot.socket, &doorbell, 1) == 1) &&
+            slot.responses.pop(response))
+        {
+            WireReader reader(response);
+            int count = reader.read<int32_t>();
+            for (int i = 0; i < count; i++)
+            {
+                result.metrics.push_back(reader.read<float>());
+            }
+            result.ok = (count >= 0) && reader.ok();
+            if (count == responseTooLarge)
+            {
+                result.error = "response too large for ring";
+            }
+            else if (!result.ok) { result.error = "job could not be read"; }
+            evaluations_++;
+        }
+        else
+        {
+            result.ok = false;
+            result.crashed = true;
+            result.error = "worker crashed";
+            respawn(slot, true);
+        }
+    }
+    // Counts in a response which report failure instead of metrics.
+    static const int unreadableJob = -1;
+    static const int responseTooLarge = -2;
+    // Writing to a socket whose reader has died should fail, not kill us.
+    static void noSigPipe([[maybe_unused]] int socket)
+    {
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    }
+    static int sendFlags()
+    {
+#ifdef MSG_NOSIGNAL
+        return MSG_NOSIGNAL;
+#else
+        return 0;
+#endif
+    }
+    // Throw std::runtime_error describing failed system call and errno.
+    [[noreturn]] static void throwError(const std::string& call)
+    {
+        throw std::runtime_error("EvalWorkers " + call + " failed: " +
+                                 std::strerror(errno));
+    }
+    // Send fork server reply, with file descriptor "fd" if not -1.
+    static void sendReply(int socket, ServerReply reply, int fd)
+    {
+        iovec data = {&reply, sizeof(reply)};
+        msghdr message = {};
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        if (fd >= 0)
+        {
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(header), &fd, sizeof(int));
+        }
+        sendmsg(socket, &message, sendFlags());
+    }
+    // Receive fork server reply and file descriptor (if any, else -1).
+    static bool receiveReply(int socket, ServerReply& reply, int& fd)
+    {
+        iovec data = {&reply, sizeof(reply)};
+        msghdr message = {};
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        ssize_t size = -1;
+        do { size = recvmsg(socket, &message, MSG_WAITALL); }
+        while ((size < 0) && (errno == EINTR));
+        fd = -1;
+        for (cmsghdr* header = CMSG_FIRSTHDR(&message); header;
+             header = CMSG_NXTHDR(&message, header))
+        {
+            if ((header->cmsg_level == SOL_SOCKET) &&
+                (header->cmsg_type == SCM_RIGHTS))
+            {
+                std::memcpy(&fd, CMSG_DATA(header), sizeof(int));
+            }
+        }
+        return size == sizeof(reply);
+    }
+    const FunctionSet& function_set_;
+    GroupFunction group_function_;
+    bool per_tree_ = false;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    pid_t server_pid_ = -1;
+    int server_socket_ = -1;  // Parent's end of socket pair to fork server.
+    float failure_metric_ = std::numeric_limits<float>::lowest();
+    int evaluations_ = 0;
+    int crashes_ = 0;
+};
@@ -0,0 +1,385 @@
+//
+//  FitnessCaseDataset.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// A table of fitness cases (one per row) stored in a columnar binary file,
+// which is mmap()-ed read-only and used in place. Startup cost does not depend
+// on the size of the data: nothing is parsed or copied until it is read.
+//
+// convertCsv() makes the binary file from a CSV file (a header line of column
+// names, then one line of numbers per row). This is done once: openCsv() uses
+// a binary file next to the CSV file, converting only when it is missing or
+// older than the CSV. Each column is a contiguous array of one ColumnType,
+// aligned to 64 bytes for vector loads. column<T>() returns a ColumnView, a
+// pointer and size into the mapped file. Row subsets are also cheap: slice()
+// for a contiguous range, or gather() to copy selected rows (for example a
+// FitnessCaseSampler batch) into a contiguous buffer.
+//
+// File layout (native byte order):
+//     Header
+//     ColumnEntry[column_count]           (name, type, data offset)
+//     char[string_bytes]                  (column names)
+//     column data, each 64-byte aligned   (row_count values)
+
+#pragma once
+#include "MappedFile.h"
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+// Read-only view of (part of) a column: "size" values of type T at "data".
+template <typename T> class ColumnView
+{
+public:
+    ColumnView() {}
+    ColumnView(const T* data, size_t size) : data_(data), size_(size) {}
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    const T& operator[](size_t i) const { assert(i < size_); return data_[i]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    // View of "count" rows starting at row "first".
+    ColumnView slice(size_t first, size_t count) const
+    {
+        assert(first + count <= size_);
+        return ColumnView(data_ + first, count);
+    }
+    // Copy the given rows, in order, into "result".
+    void gather(const std::vector<int>& rows, std::vector<T>& result) const
+    {
+        result.resize(rows.size());
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            result[i] = (*this)[rows[i]];
+        }
+    }
+private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+class FitnessCaseDataset
+{
+public:
+    enum ColumnType : uint32_t { Float32, Float64, Int32 };
+    // Fixed size records stored in dataset file.
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t row_count;
+        uint32_t column_count;
+        uint32_t padding;
+        uint64_t columns_offset;
+        uint64_t strings_offset;
+        uint64_t string_bytes;
+    };
+    struct ColumnEntry
+    {
+        uint64_t name_offset;
+        uint32_t name_size;
+        uint32_t type;
+        uint64_t data_offset;
+    };
+
+    FitnessCaseDataset() {}
+    // Map the dataset file at "pathname" for reading. Check valid() after.
+    FitnessCaseDataset(const std::string& pathname) { open(pathname); }
+    bool open(const std::string& pathname)
+    {
+        valid_ = false;
+        file_.open(pathname);
+        header_ = file_.at<Header>(0);
+        if (header_ &&
+            std::equal(magic(), magic() + 8, header_->magic) &&
+            header_->version == version() &&
+            header_->byte_order == byteOrder())
+        {
+            columns_ = file_.at<ColumnEntry>(header_->columns_offset,
+                                             header_->column_count);
+            strings_ = file_.at<char>(header_->strings_offset,
+                                      header_->string_bytes);
+            valid_ = columns_ && strings_;
+            for (int i = 0; valid_ && i < columnCount(); i++)
+            {
+                valid_ = file_.at<uint8_t>(columns_[i].data_offset,
+                                           rowCount() *
+                                           typeSize(columnType(i)));
+            }
+        }
+        return valid_;
+    }
+    // Open the dataset for a CSV file, first converting it (with columns of
+    // type "type") if its binary file is missing or older than the CSV file.
+    bool openCsv(const std::string& csv_pathname, ColumnType type = Float32)
+    {
+        std::string pathname = binaryPathname(csv_pathname);
+        struct stat csv_status;
+        struct stat binary_status;
+        bool current = ((stat(csv_pathname.c_str(), &csv_status) == 0) &&
+                        (stat(pathname.c_str(), &binary_status) == 0) &&
+                        (binary_status.st_mtime >= csv_status.st_mtime));
+        converted_ = false;
+        if (!(current && open(pathname)))
+        {
+            converted_ = true;
+            file_.close();
+            if (!convertCsv(csv_pathname, pathname, type)) { return false; }
+            open(pathname);
+        }
+        return valid();
+    }
+    // Was dataset file successfully mapped, and is it in the current format?
+    bool valid() const { return valid_; }
+    // Did the most recent openCsv() convert its CSV file?
+    bool converted() const { return converted_; }
+
+    // Read-only in-place access to dataset. (No rows or columns if invalid.)
+    size_t rowCount() const { return valid_ ? header_->row_count : 0; }
+    int columnCount() const { return valid_ ? header_->column_count : 0; }
+    std::string_view columnName(int i) const
+    {
+        assert(i < columnCount());
+        return std::string_view(strings_ + columns_[i].name_offset,
+                                columns_[i].name_size);
+    }
+    ColumnType columnType(int i) const
+    {
+        assert(i < columnCount());
+        return ColumnType(columns_[i].type);
+    }
+    // Index of column with given name, or -1 if none.
+    int columnIndex(const std::string& name) const
+    {
+        for (int i = 0; i < columnCount(); i++)
+        {
+            if (columnName(i) == name) { return i; }
+        }
+        return -1;
+    }
+    // All rows of i-th column (or named column), whose type must be T.
+    template <typename T> ColumnView<T> column(int i) const
+    {
+        assert("wrong column type" && (columnType(i) == typeOf<T>()));
+        const T* data = file_.at<T>(columns_[i].data_offset, rowCount());
+        return ColumnView<T>(data, rowCount());
+    }
+    template <typename T> ColumnView<T> column(const std::string& name) const
+    {
+        int i = columnIndex(name);
+        assert("no such column" && (i >= 0));
+        return column<T>(i);
+    }
+
+    // Convert CSV file to a dataset file whose columns all have type "type".
+    // Empty or non-numeric fields become NaN (0 for Int32, whose values are
+    // clamped to its range). Returns false if files could not be read or
+    // written, or rows have the wrong field count. Writes a temporary file in
+    // the same directory then renames it, so "pathname" is never incomplete.
+    static bool convertCsv(const std::string& csv_pathname,
+                           const std::string& pathname,
+                           ColumnType type = Float32)
+    {
+        MappedFile csv(csv_pathname);
+        if (!csv.valid()) return false;
+        const char* text = reinterpret_cast<const char*>(csv.data());
+        const char* text_end = text + csv.size();
+        // First pass: column names from header line, then count rows.
+        const char* line = text;
+        const char* line_end = lineEnd(line, text_end);
+        std::vector<std::string> names;
+        forEachField(line, line_end, [&](const char* f, const char* f_end)
+        {
+            std::string name = trim(f, f_end);
+            if ((name.size() > 1) && (name.front() == '"') &&
+                (name.back() == '"'))
+            {
+                name = name.substr(1, name.size() - 2);
+            }
+            names.push_back(name);
+        });
+        const char* data_start = next(line_end, text_end);
+        uint64_t row_count = 0;
+        for (line = data_start; line < text_end; line = next(line, text_end))
+        {
+            line_end = lineEnd(line, text_end);
+            if (!blank(line, line_end)) { row_count++; }
+            line = line_end;
+        }
+        // Lay out file.
+        std::string strings;
+        std::vector<ColumnEntry> columns;
+        for (auto& name : names)
+        {
+            columns.push_back({strings.size(), uint32_t(name.size()), type, 0});
+            strings += name;
+        }
+        Header header = {};
+        std::copy(magic(), magic() + 8, header.magic);
+        header.version = version();
+        header.byte_order = byteOrder();
+        header.row_count = row_count;
+        header.column_count = uint32_t(columns.size());
+        header.columns_offset = align(sizeof(Header), 8);
+        header.strings_offset = (header.columns_offset +
+                                 columns.size() * sizeof(ColumnEntry));
+        header.string_bytes = strings.size();
+        uint64_t size = header.strings_offset + strings.size();
+        for (auto& column : columns)
+        {
+            column.data_offset = align(size, 64);
+            size = column.data_offset + row_count * typeSize(type);
+        }
+        // Map output file writable, store tables then parse rows into columns.
+        std::string temp = pathname + "." + std::to_string(getpid()) + ".tmp";
+        int fd = ::open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        bool ok = (ftruncate(fd, size) == 0);
+        void* address = (ok ?
+                         mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0) :
+                         MAP_FAILED);
+        ::close(fd);
+        ok = ok && (address != MAP_FAILED);
+        if (!ok) { std::remove(temp.c_str()); return false; }
+        uint8_t* out = static_cast<uint8_t*>(address);
+        std::memcpy(out, &header, sizeof(Header));
+        std::memcpy(out + header.columns_offset, columns.data(),
+                    columns.size() * sizeof(ColumnEntry));
+        std::memcpy(out + header.strings_offset, strings.data(),
+                    strings.size());
+        uint64_t row = 0;
+        for (line = data_start; ok && (line < text_end);
+             line = next(line, text_end))
+        {
+            line_end = lineEnd(line, text_end);
+            if (!blank(line, line_end))
+            {
+                size_t c = 0;
+                forEachField(line, line_end,
+                             [&](const char* f, const char* f_end)
+                {
+                    if (c < columns.size())
+                    {
+                        uint8_t* value = (out + columns[c].data_offset +
+                                          row * typeSize(type));
+                        storeValue(type, f, f_end, value);
+                    }
+                    c++;
+                });
+                ok = (c == columns.size());
+                row++;
+            }
+            line = line_end;
+        }
+        munmap(address, size);
+        ok = ok && (std::rename(temp.c_str(), pathname.c_str()) == 0);
+        if (!ok) { std::remove(temp.c_str()); }
+        return ok;
+    }
+    // Name of binary file used by openCsv() for a CSV file.
+    static std::string binaryPathname(const std::string& csv_pathname)
+    {
+        return csv_pathname + ".lpcases";
+    }
+
+    // ColumnType for a C++ type, and size of a ColumnType's values.
+    template <typename T> static constexpr ColumnType typeOf()
+    {
+        static_assert(std::is_same_v<T, float> ||
+                      std::is_same_v<T, double> ||
+                      std::is_same_v<T, int32_t>);
+        return (std::is_same_v<T, float> ? Float32 :
+                (std::is_same_v<T, double> ? Float64 : Int32));
+    }
+    static size_t typeSize(ColumnType type)
+    {
+        return (type == Float64) ? sizeof(double) : 4;
+    }
+    // Identifies dataset files and their format version.
+    static const char* magic() { return "LPCASES\0"; }
+    static uint32_t version() { return 1; }
+    static uint32_t byteOrder() { return 0x01020304; }
+private:
+    static uint64_t align(uint64_t offset, uint64_t alignment)
+    {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+    // CSV scanning within [line, end) of mapped text.
+    static const char* lineEnd(const char* line, const char* end)
+    {
+        const char* newline = static_cast<const char*>
+            (std::memchr(line, '\n', end - line));
+        return newline ? newline : end;
+    }
+    static const char* next(const char* line_end, const char* end)
+    {
+        return std::min(line_end + 1, end);
+    }
+    static bool blank(const char* line, const char* line_end)
+    {
+        return trim(line, line_end).empty();
+    }
+    static std::string trim(const char* f, const char* f_end)
+    {
+        while ((f < f_end) && std::isspace(uint8_t(*f))) { f++; }
+        while ((f < f_end) && std::isspace(uint8_t(f_end[-1]))) { f_end--; }
+        return std::string(f, f_end);
+    }
+    template <typename F>
+    static void forEachField(const char* line, const char* line_end, F f)
+    {
+        const char* field = line;
+        for (const char* p = line; p <= line_end; p++)
+        {
+            if ((p == line_end) || (*p == ','))
+            {
+                f(field, p);
+                field = p + 1;
+            }
+        }
+    }
+    // Parse field text as "type", store at "out" (which may be unaligned).
+    static void storeValue(ColumnType type,
+                           const char* f,
+                           const char* f_end,
+                           uint8_t* out)
+    {
+        char buffer[64] = {0};
+        std::string field = trim(f, f_end);
+        std::strncpy(buffer, field.c_str(), sizeof(buffer) - 1);
+        char* parse_end = nullptr;
+        double value = std::strtod(buffer, &parse_end);
+        if (field.empty() || (*parse_end != 0))
+        {
+            value = std::numeric_limits<double>::quiet_NaN();
+        }
+        if (type == Float32)
+        {
+            float v = value;
+            std::memcpy(out, &v, sizeof(v));
+        }
+        else if (type == Float64)
+        {
+            std::memcpy(out, &value, sizeof(value));
+        }
+        else
+        {
+            double limit = std::numeric_limits<int32_t>::max();
+            int32_t v = (std::isnan(value) ? 0 :
+                         int32_t(std::clamp(value, -limit - 1, limit)));
+            std::memcpy(out, &v, sizeof(v));
+        }
+    }
+    MappedFile file_;
+    bool valid_ = false;
+    bool converted_ = false;
+    // Pointers into mapped file for each section.
+    const Header* header_ = nullptr;
+    const ColumnEntry* columns_ = nullptr;
+    const char* strings_ = nullptr;
+};
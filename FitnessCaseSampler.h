@@ -0,0 +1,60 @@
+//
+//  FitnessCaseSampler.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Draws random "mini-batches" of fitness cases, for a Population run with a
+// BatchFitnessFunction (see Population::evolutionStep()). Each tournament is
+// judged on a fresh batch: a random subset of batchSize() distinct case
+// indices from [0, caseCount()), sorted for locality of access.
+//
+// A cached fitness (Individual::getFitness()) then becomes an estimate: a
+// running average of its fitness on each batch it was judged on, weighted so
+// that the most recent estimateWindow() batches dominate.
+
+#pragma once
+#include "Utilities.h"
+
+class FitnessCaseSampler
+{
+public:
+    FitnessCaseSampler() {}
+    FitnessCaseSampler(int case_count, int batch_size, int estimate_window = 10)
+      : case_count_(case_count),
+        batch_size_(std::min(batch_size, case_count)),
+        estimate_window_(estimate_window)
+    {
+        assert(batch_size > 0);
+        cases_.resize(case_count_);
+        for (int i = 0; i < case_count_; i++) { cases_[i] = i; }
+    }
+    int caseCount() const { return case_count_; }
+    int batchSize() const { return batch_size_; }
+    int estimateWindow() const { return estimate_window_; }
+    // Draw a new random batch, and return it.
+    const std::vector<int>& nextBatch()
+    {
+        // Partial Fisher-Yates shuffle selects first batch_size_ elements.
+        for (int i = 0; i < batch_size_; i++)
+        {
+            std::swap(cases_[i], cases_[i + LPRS().randomN(case_count_ - i)]);
+        }
+        batch_.assign(cases_.begin(), cases_.begin() + batch_size_);
+        std::sort(batch_.begin(), batch_.end());
+        batches_++;
+        return batch_;
+    }
+    // The current batch, and number of batches drawn.
+    const std::vector<int>& batch() const { return batch_; }
+    int batches() const { return batches_; }
+private:
+    int case_count_ = 0;
+    int batch_size_ = 0;
+    int estimate_window_ = 10;
+    std::vector<int> cases_;
+    std::vector<int> batch_;
+    int batches_ = 0;
+};
@@ -31,16 +31,49 @@
 #include "GpType.h"
 #include "GpFunction.h"
 #include "GpTree.h"
+#include <unordered_map>
 
 // Used only below in FunctionSet, then undef-ed at end of file.
-#define name_lookup_util(name, map)               \
-[&]()                                             \
-{                                                 \
-    auto it = map.find(name);                     \
-    assert("unknown type" && (it != map.end()));  \
-    return &(it->second);                         \
+#define name_lookup_util(name, index, storage)      \
+[&]()                                               \
+{                                                   \
+    auto it = index.find(name);                     \
+    assert("unknown type" && (it != index.end()));  \
+    return &(storage.at(it->second));               \
 }()
 
+// Read-only view of a FunctionSet's GpTypes or GpFunctions in name order,
+// with the parts of the std::map interface FunctionSet once exposed. Elements
+// are (name, object) pairs, so "for (auto& [name, t] : view)" still works.
+template <typename T> class NameMapView
+{
+public:
+    typedef std::pair<const std::string, T&> value_type;
+    template <typename Storage>
+    NameMapView(Storage& storage,
+                const std::unordered_map<std::string, int>& index)
+      : index_(index)
+    {
+        entries_.reserve(storage.size());
+        for (T& object : storage)
+        {
+            entries_.emplace_back(object.name(), object);
+        }
+    }
+    auto begin() const { return entries_.begin(); }
+    auto end() const { return entries_.end(); }
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    size_t count(const std::string& name) const { return index_.count(name); }
+    T& at(const std::string& name) const
+    {
+        return entries_.at(index_.at(name)).second;
+    }
+private:
+    std::vector<value_type> entries_;
+    const std::unordered_map<std::string, int>& index_;
+};
+
 // Defines the function set used in a STGP run. Consists of a collection of
 // GpTypes and one of GpFunctions. Supports creation of random program drawn
 // from those types and functions, given a max_size and root type.
@@ -61,18 +94,22 @@ public:
                 int crossover_min_size)
         : crossover_min_size_(crossover_min_size)
     {
-        // Process each GpType specifications, make local copy to modify.
-        for (GpType gp_type : type_specs)
+        // Copy GpType specifications into storage, assigning IDs.
+        storeByName(type_specs, gp_types_, gp_type_index_);
+        for (GpType& gp_type : gp_types_)
         {
             bool has_eg = gp_type.hasEphemeralGenerator();
             if (has_eg) gp_type.setMinSizeToTerminate(1);
-            // Insert updated GpType into by-name map. (Copied again into map.)
-            addGpType(gp_type);
-            // Root type (for trees of this FS) defaults to first GpType listed.
-            if (!getRootType()) setRootType(lookupGpTypeByName(gp_type.name()));
         }
-        // Process each of the GpFunction specifications (copy then modify)
-        for (GpFunction func : function_specs)
+        // Root type (for trees of this FS) defaults to first GpType listed.
+        if (!type_specs.empty())
+        {
+            setRootType(lookupGpTypeByName(type_specs.front().name()));
+        }
+        // Copy GpFunction specifications into storage, assigning IDs.
+        storeByName(function_specs, gp_functions_, gp_function_index_);
+        // Process each of the GpFunctions.
+        for (GpFunction& func : gp_functions_)
         {
             // Character string name of this function's return type.
             std::string rtn = func.returnTypeName();
@@ -95,20 +132,19 @@ public:
                     rt.setMinSizeToTerminate(mstt);
                 // std::cout << " min size to terminate: " << mstt << std::endl;
             }
-            // Copy once more into name-to-GpFunction-object map.
-            addGpFunction(func);
         }
         // Build per-GpType collections of GpFunctions returning that type.
-        for (auto& [name, gp_function] : nameToGpFunctionMap())
+        for (auto& gp_function : gp_functions_)
         {
             gp_function.linkToReturnType();
         }
         // Set minSizeToTerminate() for each GpFunction.
-        for (auto& [name, gp_function] : nameToGpFunctionMap())
+        for (auto& gp_function : gp_functions_)
         {
             int min_size = minSizeToTerminateFunction(gp_function);
             gp_function.setMinSizeToTerminate(min_size);
         }
+        updateMinCostsToTerminate();
     }
     
     // What is the minimum "size" required to terminate a program subtree with
@@ -126,17 +162,125 @@ public:
         return size;
     }
 
+    // Compute minCostToTerminate() for each GpType and GpFunction, from the
+    // evalCost() of each GpFunction. Repeats until no type's cost decreases,
+    // since a type's min cost depends on those of its functions' parameters.
+    void updateMinCostsToTerminate()
+    {
+        float infinity = std::numeric_limits<float>::infinity();
+        for (auto& gp_type : gp_types_)
+        {
+            gp_type.setMinCostToTerminate(gp_type.hasEphemeralGenerator() ?
+                                          0 : infinity);
+        }
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (auto& gp_function : gp_functions_)
+            {
+                float cost = gp_function.evalCost();
+                for (auto& parameter_type : gp_function.parameterTypes())
+                {
+                    cost += parameter_type->minCostToTerminate();
+                }
+                gp_function.setMinCostToTerminate(cost);
+                GpType& return_type = *gp_function.returnType();
+                if (cost < return_type.minCostToTerminate())
+                {
+                    return_type.setMinCostToTerminate(cost);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Set the estimated evaluation cost of the named GpFunction.
+    void setEvalCost(const std::string& function_name, float cost)
+    {
+        lookupGpFunctionByName(function_name)->setEvalCost(cost);
+        updateMinCostsToTerminate();
+    }
+    // Declare the named GpFunction to be pure (or not), see EvalPlan.h.
+    void setPure(const std::string& function_name, bool pure)
+    {
+        lookupGpFunctionByName(function_name)->setPure(pure);
+    }
+    // Declare the named GpFunction to be foldable (or not), see EvalPlan.h.
+    void setFoldable(const std::string& function_name, bool foldable)
+    {
+        lookupGpFunctionByName(function_name)->setFoldable(foldable);
+    }
+    // Set parallelSafe() of the named GpFunction, see GpTree::evalParallel().
+    void setParallelSafe(const std::string& function_name, bool safe)
+    {
+        lookupGpFunctionByName(function_name)->setParallelSafe(safe);
+    }
+    // Set strictArguments() of the named GpFunction, see evalParallel().
+    void setStrictArguments(const std::string& function_name, bool strict)
+    {
+        lookupGpFunctionByName(function_name)->setStrictArguments(strict);
+    }
+    // Set C++ code template of the named GpFunction, see NativeCode.h.
+    void setCodeTemplate(const std::string& function_name,
+                         const std::string& code)
+    {
+        lookupGpFunctionByName(function_name)->setCodeTemplate(code);
+    }
+    // Set evalCost() of each GpFunction to its mean self time per call as
+    // measured by GpFunctionProfiler, relative to the cheapest profiled
+    // GpFunction. So costs stay in the default units (1 is about one call of
+    // the cheapest function) and remain comparable with those of GpFunctions
+    // not in the profile, which keep their current cost.
+    void learnEvalCosts()
+    {
+        auto report = GpFunctionProfiler::report();
+        auto mean_ns = [](const GpFunctionProfiler::Stats& stats)
+        {
+            return float(stats.self_ns) / stats.calls;
+        };
+        float unit = std::numeric_limits<float>::infinity();
+        for (auto& stats : report)
+        {
+            if ((stats.calls > 0) && (mean_ns(stats) > 0))
+            {
+                unit = std::min(unit, mean_ns(stats));
+            }
+        }
+        if (std::isinf(unit)) { return; }
+        for (auto& stats : report)
+        {
+            auto it = gp_function_index_.find(stats.name);
+            if ((it != gp_function_index_.end()) && (stats.calls > 0))
+            {
+                GpFunction& gp_function = gp_functions_.at(it->second);
+                gp_function.setEvalCost(std::max(mean_ns(stats), unit) / unit);
+            }
+        }
+        updateMinCostsToTerminate();
+    }
+
     // Randomly select a function in this set that returns the given type and
     // can be implemented in a subtree no larger than max_size. Returns nullptr
     // if none found.
     GpFunction* randomFunctionOfTypeInSize(int max_size,
                                            const GpType& return_type) const
+    {
+        float unlimited = std::numeric_limits<float>::infinity();
+        return randomFunctionOfTypeInSize(max_size, unlimited, return_type);
+    }
+    // As above, additionally requiring that the minimum cost of a subtree with
+    // the function at root be no more than max_cost.
+    GpFunction* randomFunctionOfTypeInSize(int max_size,
+                                           float max_cost,
+                                           const GpType& return_type) const
     {
         std::vector<GpFunction*> ok;
         for (auto& gp_function : return_type.functionsReturningThisType())
         {
             int ms = gp_function->minSizeToTerminate();
-            if (max_size >= ms) { ok.push_back(gp_function); }
+            float mc = gp_function->minCostToTerminate();
+            if ((max_size >= ms) && (max_cost >= mc)) ok.push_back(gp_function);
         }
         // Intended to be used only for testing and debugging
         if (function_filter) { function_filter(ok); };
@@ -170,14 +314,34 @@ public:
                         const GpType& return_type,
                         int& output_actual_size,
                         GpTree& gp_tree) const
+    {
+        float unlimited = std::numeric_limits<float>::infinity();
+        makeRandomTree(max_size, unlimited, return_type,
+                       output_actual_size, gp_tree);
+    }
+
+    // As above, with a budget "max_cost" on the resulting tree's cost(). The
+    // budget is not enforced for GpTypes that cannot be terminated within it.
+    void makeRandomTree(int max_size,
+                        float max_cost,
+                        const GpType& return_type,
+                        int& output_actual_size,
+                        GpTree& gp_tree) const
     {
         // Find all function whose value is return_type, for which a subtree can
         // be constructed in max_size or fewer nodes, and select on randomly.
-        GpFunction* rf = randomFunctionOfTypeInSize(max_size, return_type);
+        GpFunction* rf = randomFunctionOfTypeInSize(max_size, max_cost,
+                                                    return_type);
+        // If over cost budget and no leaf available, ignore cost budget.
+        if (!rf && !return_type.hasEphemeralGenerator() &&
+            !std::isinf(max_cost))
+        {
+            rf = randomFunctionOfTypeInSize(max_size, return_type);
+        }
         if (rf)
         {
             // If found, recurse on a subtree with that function at the root.
-            makeRandomTreeRoot(max_size, return_type, *rf,
+            makeRandomTreeRoot(max_size, max_cost, return_type, *rf,
                                output_actual_size, gp_tree);
         }
         else if (return_type.hasEphemeralGenerator())
@@ -233,14 +397,41 @@ public:
                        output_gp_tree);
     }
 
+    // Overload to pass "max_size", "max_cost", and "output_gp_tree", returning
+    // the FunctionSet's root type.
+    void makeRandomTree(int max_size,
+                        float max_cost,
+                        GpTree& output_gp_tree) const
+    {
+        int output_actual_size = 0;
+        makeRandomTree(max_size,
+                       max_cost,
+                       *getRootType(),
+                       output_actual_size,
+                       output_gp_tree);
+    }
+
     void makeRandomTreeRoot(int max_size,
                             const GpType& return_type,
                             const GpFunction& root_function,
                             int& output_actual_size,
                             GpTree& gp_tree) const
+    {
+        float unlimited = std::numeric_limits<float>::infinity();
+        makeRandomTreeRoot(max_size, unlimited, return_type, root_function,
+                           output_actual_size, gp_tree);
+    }
+
+    void makeRandomTreeRoot(int max_size,
+                            float max_cost,
+                            [[maybe_unused]] const GpType& return_type,
+                            const GpFunction& root_function,
+                            int& output_actual_size,
+                            GpTree& gp_tree) const
     {
         output_actual_size++;  // for "function_name" (or epheneral) itself
         int size_used = 0;
+        float cost_used = root_function.evalCost();
         int count = int(root_function.parameterTypes().size());
         // Set root function in given GpTree object
         gp_tree.setRootFunction(root_function);
@@ -255,16 +446,22 @@ public:
             int fair_share = (max_size - (1 + size_used)) / count;
             int min_size_for_type = parameter_type->minSizeToTerminate();
             int subtree_max_size = std::max(fair_share, min_size_for_type);
+            float cost_share = (max_cost - cost_used) / count;
+            float min_cost_for_type = parameter_type->minCostToTerminate();
+            float subtree_max_cost = std::max(cost_share, min_cost_for_type);
             int subtree_actual_size = 0;
             std::string subtree_source;
+            GpTree& subtree = gp_tree.subtrees().at(subtree_index);
             makeRandomTree(subtree_max_size,
+                           subtree_max_cost,
                            *parameter_type,
                            subtree_actual_size,
-                           gp_tree.subtrees().at(subtree_index));
+                           subtree);
             // TODO do this in a cleaner way after it is working
             subtree_index++;
             output_actual_size += subtree_actual_size;
             size_used += subtree_actual_size;
+            if (!std::isinf(max_cost)) { cost_used += subtree.cost(); }
             count--;
         }
     }
@@ -272,12 +469,12 @@ public:
     void print() const
     {
         std::cout << std::endl;
-        std::cout << nameToGpTypeMap().size() << " GpTypes: " << std::endl;
-        for (auto& [n, t] : nameToGpTypeMap()) t.print();
+        std::cout << gpTypes().size() << " GpTypes: " << std::endl;
+        for (auto& t : gpTypes()) t.print();
         std::cout << std::endl;
-        std::cout << nameToGpFunctionMap().size() << " GpFunctions: ";
+        std::cout << gpFunctions().size() << " GpFunctions: ";
         std::cout << std::endl;
-        for (auto& [n, f] : nameToGpFunctionMap()) f.print();
+        for (auto& f : gpFunctions()) f.print();
         std::cout << std::endl;
     }
 
@@ -285,22 +482,52 @@ public:
     // const (public, read only) and non-const (private, writable, for internal
     // use only during constructor). Use macro to remove code duplication.
     const GpType* lookupGpTypeByName(const std::string& name) const
-        { return name_lookup_util(name, nameToGpTypeMap()); }
+        { return name_lookup_util(name, gp_type_index_, gp_types_); }
     const GpFunction* lookupGpFunctionByName(const std::string& name) const
-        { return name_lookup_util(name, nameToGpFunctionMap()); }
-    
-    // Add new GpType/GpFunction to FunctionSet, stored in a name-to-object map.
-    void addGpType(GpType& type) { name_to_gp_type_[type.name()] = type; }
-    void addGpFunction(GpFunction& f) { name_to_gp_function_[f.name()] = f; }
-    // Get reference to name-to-object maps of all GpType/GpFunction objects
-    std::map<std::string, GpType>& nameToGpTypeMap()
-        { return name_to_gp_type_; }
-    const std::map<std::string, GpType>& nameToGpTypeMap() const
-        { return name_to_gp_type_; }
-    std::map<std::string, GpFunction>& nameToGpFunctionMap()
-        { return name_to_gp_function_; }
-    const std::map<std::string, GpFunction>& nameToGpFunctionMap() const
-        { return name_to_gp_function_; }
+        { return name_lookup_util(name, gp_function_index_, gp_functions_); }
+    // Like lookup above but returns nullptr for unknown names.
+    const GpType* findGpTypeByName(const std::string& name) const
+    {
+        auto it = gp_type_index_.find(name);
+        return (it == gp_type_index_.end()) ? nullptr : &gpTypeById(it->second);
+    }
+    const GpFunction* findGpFunctionByName(const std::string& name) const
+    {
+        auto it = gp_function_index_.find(name);
+        return ((it == gp_function_index_.end()) ?
+                nullptr : &gpFunctionById(it->second));
+    }
+    // Get GpType/GpFunction by its dense integer id().
+    const GpType& gpTypeById(int id) const { return gp_types_.at(id); }
+    const GpFunction& gpFunctionById(int id) const
+        { return gp_functions_.at(id); }
+
+    // Get reference to vector of all GpType/GpFunction objects, indexed by
+    // id(), which is in order of their names. Read only: GpTrees hold pointers
+    // into these vectors, so they must not be resized.
+    const std::vector<GpType>& gpTypes() const { return gp_types_; }
+    const std::vector<GpFunction>& gpFunctions() const { return gp_functions_; }
+
+    // Deprecated, use gpTypes()/gpFunctions() and lookup/find by name. These
+    // provide the read and iterate parts of the std::map interface used when
+    // GpTypes and GpFunctions were stored in name-to-object maps.
+    NameMapView<GpType> nameToGpTypeMap()
+        { return NameMapView<GpType>(gp_types_, gp_type_index_); }
+    NameMapView<const GpType> nameToGpTypeMap() const
+        { return NameMapView<const GpType>(gp_types_, gp_type_index_); }
+    NameMapView<GpFunction> nameToGpFunctionMap()
+        { return NameMapView<GpFunction>(gp_functions_, gp_function_index_); }
+    NameMapView<const GpFunction> nameToGpFunctionMap() const
+    {
+        return NameMapView<const GpFunction>(gp_functions_,
+                                             gp_function_index_);
+    }
+    // Deprecated, pass all GpTypes and GpFunctions to the constructor. Adds a
+    // GpType/GpFunction, replacing one with the same name, by rebuilding the
+    // FunctionSet. So pointers to its existing GpTypes and GpFunctions (such
+    // as those held by GpTrees) become invalid.
+    void addGpType(GpType& type) { rebuild(&type, nullptr); }
+    void addGpFunction(GpFunction& f) { rebuild(nullptr, &f); }
     
     // The type returned from the root of trees built from this function set.
     const GpType*  getRootType() const { return root_type_; }
@@ -319,15 +546,53 @@ public:
     int getCrossoverMinSize() const { return crossover_min_size_; }
     
 private:
-    // These maps are used both to store the GpType and GpFunction objects,
-    // plus to look up those objects from their character string names.
-    std::map<std::string, GpType> name_to_gp_type_;
-    std::map<std::string, GpFunction> name_to_gp_function_;
+    // Copy "specs" into "storage" in order of their names, with each one's
+    // id() set to its index, and build name-to-index "index". (A later spec
+    // replaces an earlier one with the same name.) Ordering by name preserves
+    // the order from when these were stored in an std::map, so random trees
+    // for a given seed are unchanged. Since pointers into "storage" are kept
+    // (for example by GpTree) it must not be modified after construction.
+    template <typename T>
+    static void storeByName(const std::vector<T>& specs,
+                            std::vector<T>& storage,
+                            std::unordered_map<std::string, int>& index)
+    {
+        std::map<std::string, const T*> by_name;
+        for (auto& spec : specs) { by_name[spec.name()] = &spec; }
+        storage.clear();
+        storage.reserve(by_name.size());
+        index.clear();
+        for (auto& [name, spec] : by_name)
+        {
+            index[name] = int(storage.size());
+            storage.push_back(*spec);
+            storage.back().setId(index[name]);
+        }
+    }
+    // Rebuild with current GpTypes and GpFunctions plus "type"/"function".
+    // Keeps settings like evalCost() and the root type. See addGpType().
+    void rebuild(const GpType* type, const GpFunction* function)
+    {
+        std::vector<GpType> types = gp_types_;
+        std::vector<GpFunction> functions = gp_functions_;
+        if (type) { types.push_back(*type); }
+        if (function) { functions.push_back(*function); }
+        for (auto& gp_type : types) { gp_type.forgetFunctionLinks(); }
+        std::string root = root_type_ ? root_type_->name() : "";
+        *this = FunctionSet(types, functions, crossover_min_size_);
+        if (!root.empty()) { setRootType(lookupGpTypeByName(root)); }
+    }
+    // Contiguous storage for the GpType and GpFunction objects, indexed by
+    // their id(), plus hashed indexes to look them up by name.
+    std::vector<GpType> gp_types_;
+    std::vector<GpFunction> gp_functions_;
+    std::unordered_map<std::string, int> gp_type_index_;
+    std::unordered_map<std::string, int> gp_function_index_;
     // Non-const versions for use only in constructor.
     GpType* lookupGpTypeByName(const std::string& name)
-        { return name_lookup_util(name, nameToGpTypeMap()); }
+        { return name_lookup_util(name, gp_type_index_, gp_types_); }
     GpFunction* lookupGpFunctionByName(const std::string& name)
-        { return name_lookup_util(name, nameToGpFunctionMap()); }
+        { return name_lookup_util(name, gp_function_index_, gp_functions_); }
     // The type returned from the root of trees built from this function set.
     GpType* root_type_ = nullptr;
     // The smallest size for a subtree (GpTree) to be exchanged between parent
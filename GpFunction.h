@@ -9,6 +9,7 @@
 #pragma once
 #include "Utilities.h"
 #include "GpType.h"
+#include "GpFunctionProfiler.h"
 
 class GpTree;      // Forward reference to class defined later.
 
@@ -28,13 +29,26 @@ public:
                const std::vector<std::string>& parameter_type_names,
                std::function<std::any(GpTree& t)> eval,
                float selection_weight)
+      : GpFunction(name, return_type_name, parameter_type_names, eval,
+                   selection_weight, 1) {}
+
+    GpFunction(const std::string& name,
+               const std::string& return_type_name,
+               const std::vector<std::string>& parameter_type_names,
+               std::function<std::any(GpTree& t)> eval,
+               float selection_weight,
+               float eval_cost)
       : name_(name),
         return_type_name_(return_type_name),
         parameter_type_names_(parameter_type_names),
         eval_(eval),
-        selection_weight_(selection_weight) {}
+        selection_weight_(selection_weight),
+        eval_cost_(eval_cost) {}
     // String name of this GpFunction.
     const std::string& name() const { return name_; }
+    // Dense integer ID, the index of this GpFunction in its FunctionSet.
+    int id() const { return id_; }
+    void setId(int id) { id_ = id; }
     // String name of this GpFunction's return type.
     const std::string& returnTypeName() const { return return_type_name_; }
     // Pointer to this GpFunction's return GpType.
@@ -59,9 +73,46 @@ public:
     // Minimum "size" required to terminate subtree with this function at root.
     int minSizeToTerminate() const { return min_size_to_terminate_; }
     void setMinSizeToTerminate(int s) { min_size_to_terminate_ = s; }
+    // Estimated cost to evaluate this function, not including its parameter
+    // subtrees. Units are arbitrary (default is 1 per call) but should be
+    // consistent within a FunctionSet, see FunctionSet::learnEvalCosts().
+    float evalCost() const { return eval_cost_; }
+    void setEvalCost(float cost) { eval_cost_ = cost; }
+    // A "pure" function has no side effects, and its value depends only on its
+    // parameters and on state that is constant during one tree evaluation
+    // (such as the current fitness case). So EvalPlan may merge identical
+    // calls within one evaluation.
+    bool pure() const { return pure_; }
+    void setPure(bool pure) { pure_ = pure; }
+    // A "foldable" function is pure and its value depends only on its
+    // parameters (not on the current fitness case, etc.). So EvalPlan may
+    // evaluate it once, at compile time, when its parameters are constant.
+    bool foldable() const { return foldable_; }
+    void setFoldable(bool foldable) { foldable_ = foldable; }
+    // Is this function safe to evaluate concurrently with other subtrees of a
+    // tree? Used by GpTree::evalParallel(), see also evalCost().
+    bool parallelSafe() const { return parallel_safe_; }
+    void setParallelSafe(bool safe) { parallel_safe_ = safe; }
+    // Does this function always evaluate all of its parameter subtrees? (Not,
+    // say, a conditional which evaluates only one branch.) Only then does
+    // GpTree::evalParallel() evaluate its subtrees ahead of it, concurrently.
+    bool strictArguments() const { return strict_arguments_; }
+    void setStrictArguments(bool strict) { strict_arguments_ = strict; }
+    // C++ expression template for native code generation (see NativeCode.h).
+    // Parameters are written $0, $1, ... for example "($0 + $1)".
+    const std::string& codeTemplate() const { return code_template_; }
+    void setCodeTemplate(const std::string& code) { code_template_ = code; }
+    // Minimum evaluation cost of a subtree with this function at root.
+    float minCostToTerminate() const { return min_cost_to_terminate_; }
+    void setMinCostToTerminate(float c) { min_cost_to_terminate_ = c; }
     // Evaluate (execute) a GpTree with this function at root
     // TODO probably should assert they match (this and tree root GpFunction)
-    std::any eval(GpTree& tree) const { return eval_(tree);  }
+    std::any eval(GpTree& tree) const
+    {
+        if (!GpFunctionProfiler::enabled()) return eval_(tree);
+        GpFunctionProfiler::Scope scope(this, name());
+        return eval_(tree);
+    }
     // Called by FunctionSet init while linking types and functions.
     void linkToReturnType()
     {
@@ -73,7 +124,7 @@ public:
         std::cout << "GpFunction: " << name() << ", return_type: ";
         std::cout << returnTypeName() << ", parameters: (";
         bool comma = false;
-        for (int i = 0; i < parameterTypes().size(); i ++)
+        for (size_t i = 0; i < parameterTypes().size(); i ++)
         {
             if (comma) std::cout << ", "; else comma = true;
             std::cout << parameterTypeNames().at(i);
@@ -84,6 +135,7 @@ public:
     float selectionWeight() const { return selection_weight_; }
 private:
     std::string name_;
+    int id_ = -1;
     std::string return_type_name_;
     GpType* return_type_ = nullptr;
     std::vector<std::string> parameter_type_names_;
@@ -91,4 +143,11 @@ private:
     int min_size_to_terminate_ = std::numeric_limits<int>::max();
     std::function<std::any(GpTree& t)> eval_ = nullptr;
     float selection_weight_ = 1;
+    float eval_cost_ = 1;
+    bool pure_ = false;
+    bool foldable_ = false;
+    bool parallel_safe_ = false;
+    bool strict_arguments_ = false;
+    std::string code_template_;
+    float min_cost_to_terminate_ = std::numeric_limits<float>::infinity();
 };
@@ -0,0 +1,166 @@
+//
+//  GpFunctionProfiler.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Optional runtime profiling of GpFunction evaluation. When enabled, each call
+// to GpFunction::eval() records: call count, total (inclusive) time, self time
+// (excluding nested GpFunction calls for parameter subtrees), and heap
+// allocations made by the function itself. Data is kept per thread and merged
+// on demand into a report sorted by total time. (Compare CountFunctionUsage in
+// Population.h which counts static occurrences of GpFunctions in trees.)
+//
+// Allocations can only be counted if the application's global operator new
+// calls GpFunctionProfiler::countAllocation(), as in Benchmark.cpp, since a
+// header-only library cannot itself replace operator new.
+
+#pragma once
+#include "Utilities.h"
+#include "Instrumentation.h"
+#include <unordered_map>
+
+class GpFunction;  // Forward reference to class defined later.
+
+class GpFunctionProfiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    // Profile data for one GpFunction.
+    struct Stats
+    {
+        std::string name;
+        uint64_t calls = 0;
+        uint64_t total_ns = 0;
+        uint64_t self_ns = 0;
+        uint64_t allocations = 0;
+        uint64_t allocated_bytes = 0;
+        void merge(const Stats& other)
+        {
+            calls += other.calls;
+            total_ns += other.total_ns;
+            self_ns += other.self_ns;
+            allocations += other.allocations;
+            allocated_bytes += other.allocated_bytes;
+        }
+    };
+
+    // Profiling is off by default.
+    static bool enabled() { return enabled_; }
+    static void setEnabled(bool enabled) { enabled_ = enabled; }
+
+    // Times one call to a GpFunction, created in GpFunction::eval().
+    class Scope
+    {
+    public:
+        Scope(const GpFunction* function, const std::string& name)
+        {
+            stack_.push_back({function, &name, Clock::now(),
+                              allocation_count_, allocation_bytes_, 0, 0, 0});
+        }
+        ~Scope()
+        {
+            Frame frame = stack_.back();
+            stack_.pop_back();
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>
+                (Clock::now() - frame.start).count();
+            uint64_t allocations = allocation_count_ - frame.allocations;
+            uint64_t bytes = allocation_bytes_ - frame.bytes;
+            // Nested (recursive) calls to the same GpFunction are counted
+            // once in total time, by their outermost call.
+            bool nested = false;
+            for (auto& f : stack_)
+                if (f.function == frame.function) nested = true;
+            per_thread_.update([&](ThreadData& data)
+            {
+                Stats& stats = data[frame.function];
+                if (stats.name.empty()) stats.name = *frame.name;
+                stats.calls++;
+                if (!nested) stats.total_ns += ns;
+                stats.self_ns += ns - frame.child_ns;
+                stats.allocations += allocations - frame.child_allocations;
+                stats.allocated_bytes += bytes - frame.child_bytes;
+            });
+            if (!stack_.empty())
+            {
+                stack_.back().child_ns += ns;
+                stack_.back().child_allocations += allocations;
+                stack_.back().child_bytes += bytes;
+            }
+        }
+    };
+
+    // Call from global operator new to attribute heap allocations.
+    static void countAllocation(size_t bytes)
+    {
+        allocation_count_++;
+        allocation_bytes_ += bytes;
+    }
+
+    // Merge all threads' data into a vector sorted by decreasing total time.
+    static std::vector<Stats> report()
+    {
+        std::map<std::string, Stats> by_name;
+        per_thread_.forEach([&](const ThreadData& data, int)
+        {
+            for (auto& [function, stats] : data)
+            {
+                Stats& s = by_name[stats.name];
+                s.name = stats.name;
+                s.merge(stats);
+            }
+        });
+        std::vector<Stats> sorted;
+        for (auto& [name, stats] : by_name) { sorted.push_back(stats); }
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const Stats& a, const Stats& b)
+                  { return a.total_ns > b.total_ns; });
+        return sorted;
+    }
+    // Discard all profile data.
+    static void reset() { per_thread_.clear(); }
+
+    // Print report() as a table, one row per GpFunction.
+    static void print()
+    {
+        std::vector<Stats> stats = report();
+        size_t width = 12;
+        for (auto& s : stats) { width = std::max(width, s.name.size() + 2); }
+        std::cout << std::left << std::setw(int(width)) << "GpFunction";
+        std::cout << std::right << "      calls   total ms    self ms";
+        std::cout << "  self ns/call  allocs/call" << std::endl;
+        for (auto& s : stats)
+        {
+            double calls = std::max(uint64_t(1), s.calls);
+            std::cout << std::left << std::setw(int(width)) << s.name;
+            std::cout << std::right << std::fixed << std::setprecision(2);
+            std::cout << std::setw(11) << s.calls;
+            std::cout << std::setw(11) << s.total_ns / 1e6;
+            std::cout << std::setw(11) << s.self_ns / 1e6;
+            std::cout << std::setw(14) << s.self_ns / calls;
+            std::cout << std::setw(13) << s.allocations / calls << std::endl;
+        }
+        std::cout << std::defaultfloat;
+    }
+private:
+    // One active call on this thread's stack of GpFunction evaluations.
+    struct Frame
+    {
+        const GpFunction* function;
+        const std::string* name;
+        Clock::time_point start;
+        uint64_t allocations;
+        uint64_t bytes;
+        uint64_t child_ns;
+        uint64_t child_allocations;
+        uint64_t child_bytes;
+    };
+    typedef std::unordered_map<const GpFunction*, Stats> ThreadData;
+    static inline std::atomic<bool> enabled_ = false;
+    static inline PerThread<ThreadData> per_thread_;
+    static inline thread_local std::vector<Frame> stack_;
+    static inline thread_local uint64_t allocation_count_ = 0;
+    static inline thread_local uint64_t allocation_bytes_ = 0;
+};
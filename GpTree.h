@@ -10,6 +10,8 @@
 #include "Utilities.h"
 #include "GpType.h"
 #include "GpFunction.h"
+#include "EvalBudget.h"
+#include "ThreadPool.h"
 
 // GpTree: a "program tree", an "abstract syntax tree" ("AST"), to represent a
 // composition of GpFunction(s) and GpType(s). Each GpTree instance contains a
@@ -40,7 +42,7 @@ public:
     void addSubtrees(size_t count)
     {
         assert("call addSubtrees() only once" && subtrees().size() == 0);
-        for (int i = 0; i < count; i++) addSubtree();
+        for (size_t i = 0; i < count; i++) addSubtree();
     }
     // Count tokens in tree (functions or leaves/constants).
     int size() const
@@ -49,6 +51,22 @@ public:
         for (auto& subtree : subtrees()) count += subtree.size();
         return count;
     }
+    // Depth of tree: number of nodes on longest path from root to a leaf.
+    int depth() const
+    {
+        int max_subtree_depth = 0;
+        for (auto& subtree : subtrees())
+            max_subtree_depth = std::max(max_subtree_depth, subtree.depth());
+        return 1 + max_subtree_depth;
+    }
+    // Estimated cost to evaluate tree: sum of GpFunction::evalCost() for each
+    // function call. Leaf values cost nothing.
+    float cost() const
+    {
+        float sum = isLeaf() ? 0 : getRootFunction().evalCost();
+        for (auto& subtree : subtrees()) sum += subtree.cost();
+        return sum;
+    }
     // Get/set the value at the root of this GpTree. This can be either:
     // (a) a constant "leaf value" of a GpTree with no subtrees and no root
     //     function, as set during makeRandomTree().
@@ -71,11 +89,28 @@ public:
     {
         if (!isLeaf())
         {
+            // Value already computed by evalSubtreesInParallel().
+            if (prefetched_) { prefetched_ = false; return getRootValue(); }
+            EvalBudget::checkpoint();
+            bool prefetched = parallel_pool_ && evalSubtreesInParallel();
             setRootValue(getRootFunction().eval(*this),
                          *getRootFunction().returnType());
+            // In case root function did not use all prefetched values.
+            if (prefetched) { clearPrefetched(); }
         }
         return getRootValue();
     }
+    // Evaluate this tree like eval(), except that at each node whose
+    // GpFunction has strictArguments(), subtrees whose root GpFunction is
+    // parallelSafe() with evalCost() of at least "min_cost" are evaluated
+    // concurrently on "pool" (when there are two or more) before it runs. The
+    // whole subtree is evaluated on a pool thread, so all GpFunctions which
+    // can appear in it must be thread safe. Not parallel inside an EvalBudget.
+    std::any evalParallel(ThreadPool& pool, float min_cost = 0)
+    {
+        ParallelScope scope(&pool, min_cost);
+        return eval();
+    }
     // Evaluate i-th subtree, corresponds to i-th parameter of root function,
     // then cast the resulting std::any to the given concrete type T.
     template <typename T> T evalSubtree(int i)
@@ -99,48 +134,68 @@ public:
                                  int indentation) const
     {
         std::string s;
-        if (indentation == 0) s = prefix;
-        auto new_line = [&]()
-        {
-            if (indent)
-            {
-                s += "\n";
-                s += prefix;
-                for (int i = 0; i < indentation; i++) s += " ";
-            }
-            else
-            {
-                s += " ";
-            }
-        };
-        auto all_leaves = [&]()
-        {
-            bool all = true;
-            for (auto& subtree : subtrees()) if (!subtree.isLeaf()) all = false;
-            return all;
-        };
+        to_string_helper(s, indent, prefix, indentation);
+        return s;
+    }
+    // Versions which append source code to a caller-provided string (whose
+    // storage can be reused between calls) or write it to an output stream.
+    // The whole tree is written in one pass with no temporary strings.
+    void to_string(std::string& output,
+                   bool indent = false,
+                   const std::string& prefix = "") const
+        { to_string_helper(output, indent, prefix, 0); }
+    void to_string(std::ostream& output,
+                   bool indent = false,
+                   const std::string& prefix = "") const
+        { to_string_helper(output, indent, prefix, 0); }
+    // Shared implementation for std::string or std::ostream output.
+    template <typename Output>
+    void to_string_helper(Output& output,
+                          bool indent,
+                          const std::string& prefix,
+                          int indentation) const
+    {
+        if (indentation == 0) append(output, prefix);
         if (isLeaf())
         {
-            s += getRootType()->to_string(getRootValue());
+            append(output, getRootType()->to_string(getRootValue()));
         }
         else
         {
-            bool indent_before = indent;
-            if (all_leaves()) { indent = false; }
-            size_t additional_indent = getRootFunction().name().size() + 1;
-            indentation += additional_indent;
-            s += getRootFunction().name() + "(";
+            // Children which are all leaves go on one line.
+            bool all_leaves = true;
+            for (auto& subtree : subtrees())
+                if (!subtree.isLeaf()) all_leaves = false;
+            if (all_leaves) { indent = false; }
+            const std::string& name = getRootFunction().name();
+            indentation += int(name.size()) + 1;
+            append(output, name);
+            append(output, "(");
             bool comma = false;
             for (auto& subtree : subtrees())
             {
-                if (comma) { s += ","; new_line(); } else { comma = true; }
-                s += subtree.to_string_helper(indent, prefix, indentation);
+                if (comma)
+                {
+                    append(output, ",");
+                    if (indent)
+                    {
+                        append(output, "\n");
+                        append(output, prefix);
+                        appendSpaces(output, indentation);
+                    }
+                    else
+                    {
+                        append(output, " ");
+                    }
+                }
+                else
+                {
+                    comma = true;
+                }
+                subtree.to_string_helper(output, indent, prefix, indentation);
             }
-            s += ")";
-            indentation -= additional_indent;
-            indent = indent_before;
+            append(output, ")");
         }
-        return s;
     }
 
     // Collect all subtrees into an std::vector. Recursively traverses tree from
@@ -162,9 +217,27 @@ public:
         for (auto& subtree : subtrees())
             subtree.collectSetOfTypes(set_of_types_output);
     }
+    // As above, but collecting types into a GpTypeSet (a bitset over IDs).
+    void collectSetOfTypes(GpTypeSet& set_of_types_output) const
+    {
+        set_of_types_output.insert(getRootType());
+        for (auto& subtree : subtrees())
+            subtree.collectSetOfTypes(set_of_types_output);
+    }
     
     // Given two trees find the set of types common to both. That is: collect
     // the set of types for each then take the intersection of those types.
+    static void sharedSetOfTypes(const GpTree& a,
+                                 const GpTree& b,
+                                 GpTypeSet& set_of_types_output)
+    {
+        GpTypeSet a_types;
+        GpTypeSet b_types;
+        a.collectSetOfTypes(a_types);
+        b.collectSetOfTypes(b_types);
+        set_of_types_output = a_types & b_types;
+    }
+    // As above, but collecting the shared types into an std::set.
     static void sharedSetOfTypes(const GpTree& a,
                                  const GpTree& b,
                                  std::set<const GpType*>& set_of_types_output)
@@ -203,7 +276,7 @@ public:
         auto equal_subtrees = [](const GpTree& a, const GpTree& b)
         {
             bool ok = a.subtrees_.size() == b.subtrees_.size();
-            for (int i = 0; i < a.subtrees_.size(); i++)
+            for (size_t i = 0; i < a.subtrees_.size(); i++)
                 if (!match<T>(a.getSubtree(i), b.getSubtree(i))) ok = false;
             return ok;
         };
@@ -222,6 +295,13 @@ public:
         if (rt && rt->hasDeleter()) { rt->deleteValue(getRootValue()); }
         for (auto& subtree : subtrees()) subtree.deleteCachedValues();
     }
+    // Discard (without deleting) values cached by eval() at function nodes,
+    // for a copy of a tree whose cached values are owned by the original.
+    void forgetCachedValues()
+    {
+        if (!isLeaf()) { leaf_value_.reset(); }
+        for (auto& subtree : subtrees()) subtree.forgetCachedValues();
+    }
         
     // Perform random GP crossover between the two given parents to produce a
     // new offspring, which is written into the third parameter.
@@ -231,6 +311,21 @@ public:
                           int min_size,
                           int max_size,
                           int fs_min_size)
+    {
+        float unlimited = std::numeric_limits<float>::infinity();
+        crossover(parent0, parent1, offspring,
+                  min_size, max_size, fs_min_size, unlimited);
+    }
+
+    // As above, but also attempts to keep the offspring's cost() within
+    // "max_cost". (An infinite max_cost is identical to the version above.)
+    static void crossover(const GpTree& parent0,
+                          const GpTree& parent1,
+                          GpTree& offspring,
+                          int min_size,
+                          int max_size,
+                          int fs_min_size,
+                          float max_cost)
     {
         // Randomly assign parent0/parent1 to donor/recipient roles.
         bool exchange = LPRS().randomBool();
@@ -239,7 +334,8 @@ public:
         // The offspring is initialized to a copy of the other parent.
         offspring = exchange ? parent1 : parent0;
         // Perform actual crossover.
-        crossoverDonorRecipient(donor, offspring, min_size, max_size, fs_min_size);
+        crossoverDonorRecipient(donor, offspring,
+                                min_size, max_size, fs_min_size, max_cost);
     }
 
     static void crossoverDonorRecipient(GpTree& donor,
@@ -247,30 +343,106 @@ public:
                                         int min_size,
                                         int max_size,
                                         int fs_min_size)
+    {
+        float unlimited = std::numeric_limits<float>::infinity();
+        crossoverDonorRecipient(donor, recipient,
+                                min_size, max_size, fs_min_size, unlimited);
+    }
+
+    // Crossover with a cost budget. If the offspring's cost() is over
+    // "max_cost", retry (from the original recipient) with a bias toward
+    // replacing a big recipient subtree with a small donor subtree (unless
+    // the recipient is under "min_size"). A retry is used only if its size is
+    // within [min_size, max_size]. If no attempt is within budget, the
+    // cheapest of those (and the first attempt) is used.
+    static void crossoverDonorRecipient(GpTree& donor,
+                                        GpTree& recipient,
+                                        int min_size,
+                                        int max_size,
+                                        int fs_min_size,
+                                        float max_cost)
+    {
+        if (std::isinf(max_cost))
+        {
+            crossoverBySize(donor, recipient, min_size, max_size, fs_min_size);
+        }
+        else
+        {
+            const GpTree original = recipient;
+            bool grow = original.size() < min_size;
+            GpTree cheapest;
+            float cheapest_cost = std::numeric_limits<float>::infinity();
+            for (int attempt = 0; attempt < 10; attempt++)
+            {
+                if (attempt == 0)
+                {
+                    crossoverBySize(donor, recipient,
+                                    min_size, max_size, fs_min_size);
+                }
+                else
+                {
+                    recipient = original;
+                    crossoverSubtrees(donor, recipient, fs_min_size,
+                                      grow ? +1 : -1, grow ? -1 : +1);
+                    int size = recipient.size();
+                    if ((size < min_size) || (size > max_size)) continue;
+                }
+                float cost = recipient.cost();
+                if (cost <= max_cost) return;
+                if (cost < cheapest_cost)
+                {
+                    cheapest = recipient;
+                    cheapest_cost = cost;
+                }
+            }
+            recipient = cheapest;
+        }
+    }
+
+    // Basic crossover: select a random subtree of "donor", with a root type
+    // also present in "recipient", and copy it over a random subtree of
+    // "recipient" with the same type. Size biases are -1, 0, or +1, see
+    // selectCrossoverSubtree().
+    static void crossoverSubtrees(GpTree& donor,
+                                  GpTree& recipient,
+                                  int fs_min_size,
+                                  int d_size_bias,
+                                  int r_size_bias)
     {
         // Find set of GpTypes which is common to both parents.
-        std::set<const GpType*> types;
+        GpTypeSet types;
         GpTree::sharedSetOfTypes(donor, recipient, types);
         assert(!types.empty());
-        // Basic crossover invoked for each of the three size cases below.
-        auto crosser = [&](int d_size_bias, int r_size_bias)// -1, 0, +1 (enum?)
+        // Pick a crossover subtree in the donor tree. Must return one of the
+        // common types, must be larger than the FunctionSet's min_size, and
+        // respect the given donor size bias.
+        GpTree& d_subtree = donor.selectCrossoverSubtree(fs_min_size,
+                                                         d_size_bias,
+                                                         types);
+        // Pick a crossover subtree in the donor tree. Must return the same
+        // type as d_subtree, must be larger than the FunctionSet's min_size,
+        // and respect the given recipient size bias.
+        GpTypeSet donor_type = { d_subtree.getRootType() };
+        GpTree& r_subtree = recipient.selectCrossoverSubtree(fs_min_size,
+                                                             r_size_bias,
+                                                             donor_type);
+        assert(d_subtree.getRootType() == r_subtree.getRootType());
+        // Overwrite the recipient subtree with copy of donor subtree.
+        r_subtree = d_subtree;
+    }
+
+    // Crossover which tries to keep recipient size between min_size and
+    // max_size by biasing the relative size of the exchanged subtrees.
+    static void crossoverBySize(GpTree& donor,
+                                GpTree& recipient,
+                                int min_size,
+                                int max_size,
+                                int fs_min_size)
+    {
+        auto crosser = [&](int d_size_bias, int r_size_bias)
         {
-            // Pick a crossover subtree in the donor tree. Must return one of
-            // the common types, must be larger than the FunctionSet's min_size,
-            // and respect the given donor size bias.
-            GpTree& d_subtree = donor.selectCrossoverSubtree(fs_min_size,
-                                                             d_size_bias,
-                                                             types);
-            // Pick a crossover subtree in the donor tree. Must return the same
-            // type as d_subtree, must be larger than the FunctionSet's
-            // min_size, and respect the given recipient size bias.
-            std::set<const GpType*> donor_type = { d_subtree.getRootType() };
-            GpTree& r_subtree = recipient.selectCrossoverSubtree(fs_min_size,
-                                                                 r_size_bias,
-                                                                 donor_type);
-            assert(d_subtree.getRootType() == r_subtree.getRootType());
-            // Overwrite the recipient subtree with copy of donor subtree.
-            r_subtree = d_subtree;
+            crossoverSubtrees(donor, recipient,
+                              fs_min_size, d_size_bias, r_size_bias);
         };
         // If "recipient" too big/small, try to fix via relative subtree size.
         // In each case, select random subtree from "donor" and "recipient"
@@ -298,10 +470,18 @@ public:
     GpTree& selectCrossoverSubtree(int min_size,
                                    int size_bias,  // -1, 0, +1 (enum?)
                                    const std::set<const GpType*>& types)
+    {
+        GpTypeSet type_set;
+        for (auto type : types) { type_set.insert(type); }
+        return selectCrossoverSubtree(min_size, size_bias, type_set);
+    }
+    GpTree& selectCrossoverSubtree(int min_size,
+                                   int size_bias,  // -1, 0, +1 (enum?)
+                                   const GpTypeSet& types)
     {
         GpTree* result = this;
         auto gp_type_ok = [&](GpTree* tree)
-            { return set_contains(types, tree->getRootType()); };
+            { return types.contains(tree->getRootType()); };
         if (size() > min_size)
         {
             // Find all subtrees.
@@ -340,6 +520,77 @@ public:
     }
 
 private:
+    // Output utilities for to_string_helper().
+    static void append(std::string& output, const std::string& s)
+        { output += s; }
+    static void append(std::ostream& output, const std::string& s)
+        { output << s; }
+    static void append(std::string& output, const char* s) { output += s; }
+    static void append(std::ostream& output, const char* s) { output << s; }
+    static void appendSpaces(std::string& output, int count)
+        { output.append(count, ' '); }
+    static void appendSpaces(std::ostream& output, int count)
+        { for (int i = 0; i < count; i++) output.put(' '); }
+    // State of evalParallel() on this thread.
+    class ParallelScope
+    {
+    public:
+        ParallelScope(ThreadPool* pool, float min_cost)
+          : pool_(parallel_pool_), min_cost_(parallel_min_cost_)
+        {
+            parallel_pool_ = pool;
+            parallel_min_cost_ = min_cost;
+        }
+        ~ParallelScope()
+        {
+            parallel_pool_ = pool_;
+            parallel_min_cost_ = min_cost_;
+        }
+    private:
+        ThreadPool* pool_;
+        float min_cost_;
+    };
+    // Evaluate eligible subtrees concurrently, see evalParallel(). Their
+    // values are left cached, marked for root function's evalSubtree().
+    // Returns true if any were.
+    bool evalSubtreesInParallel()
+    {
+        if (EvalBudget::current()) return false;
+        // Subtrees of a lazy or conditional function may never be needed.
+        if (!getRootFunction().strictArguments()) return false;
+        std::vector<GpTree*> eligible;
+        for (auto& subtree : subtrees())
+        {
+            if (!subtree.isLeaf() &&
+                subtree.getRootFunction().parallelSafe() &&
+                subtree.getRootFunction().evalCost() >= parallel_min_cost_)
+            {
+                eligible.push_back(&subtree);
+            }
+        }
+        if (eligible.size() < 2) return false;
+        ThreadPool* pool = parallel_pool_;
+        float min_cost = parallel_min_cost_;
+        ThreadPool::TaskGroup group(*pool);
+        for (GpTree* subtree : eligible)
+        {
+            group.run([subtree, pool, min_cost]()
+            {
+                ParallelScope scope(pool, min_cost);
+                subtree->eval();
+                subtree->prefetched_ = true;
+            });
+        }
+        try { group.wait(); }
+        catch (...) { clearPrefetched(); throw; }
+        return true;
+    }
+    void clearPrefetched()
+    {
+        for (auto& subtree : subtrees()) { subtree.prefetched_ = false; }
+    }
+    static inline thread_local ThreadPool* parallel_pool_ = nullptr;
+    static inline thread_local float parallel_min_cost_ = 0;
     // NOTE: if any more data members are added, compare them in equals().
     // Add (allocate) one subtree. addSubtrees() is external API.
     void addSubtree() { subtrees_.push_back({}); }
@@ -349,4 +600,5 @@ private:
     std::any leaf_value_;
     std::vector<GpTree> subtrees_;
     std::string id_;                            // TODO for debugging only.
+    bool prefetched_ = false;  // Transient, see evalParallel().
 };
@@ -0,0 +1,222 @@
+//
+//  GpTreeParser.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// GpTreeParser reads the "source code" text written by GpTree::to_string() (in
+// either its indented or non-indented format) back into GpTrees, checking the
+// types of all subtrees against a given FunctionSet. GpFunction names are
+// resolved with FunctionSet::findGpFunctionByName() and leaf values with the
+// from_string hook of their GpType. A single parser reads a stream containing
+// any number of programs, separated by whitespace, in one pass through a fixed
+// size buffer. So a file of many thousands of programs can be used to seed a
+// Population without first loading the whole file into memory. Nesting deeper
+// than maxDepth() is reported as an error, rather than overflowing the stack.
+
+#pragma once
+#include "FunctionSet.h"
+
+class GpTreeParser
+{
+public:
+    GpTreeParser(const FunctionSet& function_set, std::istream& stream)
+      : function_set_(function_set), stream_(stream) {}
+
+    // Parse the next program in the stream into "gp_tree", whose root must
+    // return "root_type". Returns false at end of input or after an error.
+    bool parseNext(const GpType& root_type, GpTree& gp_tree)
+    {
+        skipWhitespace();
+        if (error() || (peek() == EOF)) return false;
+        gp_tree = GpTree();
+        parseSubtree(root_type, gp_tree);
+        return !error();
+    }
+    // As above, for trees returning the FunctionSet's default root type.
+    bool parseNext(GpTree& gp_tree)
+    {
+        return parseNext(*function_set_.getRootType(), gp_tree);
+    }
+    // Parse all remaining programs in stream, passing each to "function".
+    // Returns the number of programs parsed.
+    int parseAll(std::function<void(GpTree&)> function)
+    {
+        int count = 0;
+        GpTree gp_tree;
+        while (parseNext(gp_tree)) { function(gp_tree); count++; }
+        return count;
+    }
+    // Parse a single program from a string. Returns false on error.
+    static bool parse(const FunctionSet& function_set,
+                      const std::string& source,
+                      GpTree& gp_tree)
+    {
+        std::istringstream stream(source);
+        GpTreeParser parser(function_set, stream);
+        return parser.parseNext(gp_tree);
+    }
+
+    // Has a syntax or type error been found? If so, a description of it.
+    bool error() const { return !error_message_.empty(); }
+    const std::string& errorMessage() const { return error_message_; }
+    // Current line number in stream (1 based).
+    int lineNumber() const { return line_number_; }
+    // Deepest nesting of GpFunction calls accepted in a program.
+    int maxDepth() const { return max_depth_; }
+    void setMaxDepth(int max_depth) { max_depth_ = max_depth; }
+
+private:
+    // Parse one subtree, which must return "type", into "gp_tree".
+    void parseSubtree(const GpType& type, GpTree& gp_tree, int depth = 0)
+    {
+        if (depth > maxDepth())
+        {
+            setError("nesting deeper than maxDepth() " +
+                     std::to_string(maxDepth()));
+            return;
+        }
+        skipWhitespace();
+        readToken();
+        skipWhitespace();
+        if (token_.empty())
+        {
+            setError("expected a GpFunction or leaf value of type " +
+                     type.name());
+        }
+        else if ((peek() == '(') && function_set_.findGpFunctionByName(token_))
+        {
+            const GpFunction& function =
+                *function_set_.findGpFunctionByName(token_);
+            if (function.returnType() != &type)
+            {
+                setError("GpFunction " + function.name() + " returns " +
+                         function.returnTypeName() + ", expected " +
+                         type.name());
+                return;
+            }
+            get();  // Skip "("
+            gp_tree.setRootFunction(function);
+            gp_tree.addSubtrees(function.parameterTypes().size());
+            for (size_t i = 0; i < function.parameterTypes().size(); i++)
+            {
+                if (i > 0) expect(',', function);
+                if (error()) return;
+                parseSubtree(*function.parameterTypes().at(i),
+                             gp_tree.getSubtree(i),
+                             depth + 1);
+                if (error()) return;
+            }
+            expect(')', function);
+        }
+        else
+        {
+            // Not a GpFunction call, so a leaf value. Its text may include a
+            // parenthesized part, as in "Vec2(1, 2)", which is included.
+            if (peek() == '(') readBalancedParentheses();
+            if (!type.hasFromString())
+            {
+                setError("GpType " + type.name() + " has no from_string for " +
+                         "leaf value " + token_);
+                return;
+            }
+            std::any value = type.from_string(token_);
+            if (!value.has_value())
+            {
+                setError("bad leaf value " + token_ + " for type " +
+                         type.name());
+                return;
+            }
+            gp_tree.setRootValue(value, type);
+        }
+    }
+
+    // Read a name or leaf value into token_, reusing its storage.
+    void readToken()
+    {
+        token_.clear();
+        int c = peek();
+        while ((c != EOF) && (c != '(') && (c != ')') && (c != ',') &&
+               !std::isspace(c))
+        {
+            token_ += char(get());
+            c = peek();
+        }
+    }
+    // Append a parenthesized, possibly nested, group of characters to token_.
+    void readBalancedParentheses()
+    {
+        int depth = 0;
+        do
+        {
+            int c = get();
+            if (c == EOF) { setError("unbalanced parentheses"); return; }
+            if (c == '(') depth++;
+            if (c == ')') depth--;
+            token_ += char(c);
+        }
+        while (depth > 0);
+    }
+    // Skip whitespace then require the given character.
+    void expect(char expected, const GpFunction& function)
+    {
+        skipWhitespace();
+        if (peek() == expected)
+        {
+            get();
+        }
+        else
+        {
+            setError(std::string("expected \"") + expected + "\" in " +
+                     function.name() + "(), found " + describe(peek()));
+        }
+    }
+    void skipWhitespace()
+    {
+        while ((peek() != EOF) && std::isspace(peek())) get();
+    }
+    std::string describe(int c) const
+    {
+        return (c == EOF) ? "end of input" : std::string("\"") + char(c) + "\"";
+    }
+    void setError(const std::string& message)
+    {
+        if (!error())
+        {
+            error_message_ = ("line " + std::to_string(lineNumber()) + ": " +
+                              message);
+        }
+    }
+
+    // Character level input from stream_ through buffer_.
+    int peek()
+    {
+        if ((next_ == end_) && !fillBuffer()) return EOF;
+        return (unsigned char)*next_;
+    }
+    int get()
+    {
+        int c = peek();
+        if (c != EOF) { next_++; if (c == '\n') line_number_++; }
+        return c;
+    }
+    bool fillBuffer()
+    {
+        stream_.read(buffer_.data(), buffer_.size());
+        next_ = buffer_.data();
+        end_ = next_ + stream_.gcount();
+        return next_ != end_;
+    }
+
+    const FunctionSet& function_set_;
+    std::istream& stream_;
+    std::vector<char> buffer_ = std::vector<char>(64 * 1024);
+    const char* next_ = nullptr;
+    const char* end_ = nullptr;
+    std::string token_;
+    std::string error_message_;
+    int line_number_ = 1;
+    int max_depth_ = 1000;
+};
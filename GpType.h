@@ -8,6 +8,8 @@
 
 #pragma once
 #include "Utilities.h"
+#include <bitset>
+#include <set>
 
 class GpTree;      // Forward reference to class defined later.
 class GpFunction;  // Forward reference to class defined later.
@@ -51,9 +53,18 @@ public:
                [=](){ return std::any(LPRS().random2(range_min, range_max)); },
                any_to_string<T>,
                [=](std::any x) { return jiggle(std::any_cast<T>(x), range_min,
-                                               range_max, jiggle_scale); }){}
+                                               range_max, jiggle_scale); })
+    {
+        from_string_ = any_from_string<T>;
+        if constexpr (std::is_same_v<T, float>) { cpp_type_name_ = "float"; }
+        if constexpr (std::is_same_v<T, double>) { cpp_type_name_ = "double"; }
+        if constexpr (std::is_same_v<T, int>) { cpp_type_name_ = "int"; }
+    }
     // Accessor for name.
     const std::string& name() const { return name_; }
+    // Dense integer ID, the index of this GpType in its FunctionSet.
+    int id() const { return id_; }
+    void setId(int id) { id_ = id; }
     // Does this type have an ephemeral generator?
     bool hasEphemeralGenerator() const { return bool(ephemeral_generator_); }
     // Generate an ephemeral constant.
@@ -89,9 +100,20 @@ public:
         functions_returning_this_type_.push_back(func);
         names_of_functions_returning_this_type_.push_back(name);
     }
+    // Forget GpFunctions returning this type, and the minimum size derived
+    // from them, so a FunctionSet can link them again. See addGpType().
+    void forgetFunctionLinks()
+    {
+        functions_returning_this_type_.clear();
+        names_of_functions_returning_this_type_.clear();
+        min_size_to_terminate_ = std::numeric_limits<int>::max();
+    }
     // Minimum "size" of tree returning this type from root;
     int minSizeToTerminate() const { return min_size_to_terminate_; }
     void setMinSizeToTerminate(int s) { min_size_to_terminate_ = s; }
+    // Minimum evaluation cost of tree returning this type from root.
+    float minCostToTerminate() const { return min_cost_to_terminate_; }
+    void setMinCostToTerminate(float c) { min_cost_to_terminate_ = c; }
     // Print out a description of this GpType.
     void print() const
     {
@@ -120,9 +142,66 @@ public:
                 (!functionsReturningThisType().empty()) &&
                 (minSizeToTerminate() < std::numeric_limits<int>::max()));
     }
+    // Does this GpType have a to_string function?
+    bool hasToString() const { return bool(to_string_); }
     // Uses function (supplied in constructor) to make a string of std::any
     // value via this GpType's concrete c++ type.
     std::string to_string(std::any a) const { return to_string_(a); }
+    // Text which identifies a value of this GpType, to tell if two values are
+    // equal: to_string(), except floating point values are written exactly.
+    std::string identityString(const std::any& a) const
+    {
+        auto exact = [](double d)
+        {
+            std::ostringstream ss;
+            ss << std::hexfloat << d;
+            return ss.str();
+        };
+        if (a.type() == typeid(float)) return exact(std::any_cast<float>(a));
+        if (a.type() == typeid(double)) return exact(std::any_cast<double>(a));
+        return to_string(a);
+    }
+    // Name of this GpType's C++ type, for native code generation (see
+    // NativeCode.h). Set automatically for float, double, and int ranged types.
+    const std::string& cppTypeName() const { return cpp_type_name_; }
+    void setCppTypeName(const std::string& name) { cpp_type_name_ = name; }
+    // Inverse of to_string(): parse a string back into an std::any value of
+    // this GpType. Used to restore leaf values from saved program text. Set
+    // automatically for ranged numeric types, otherwise via setFromString().
+    bool hasFromString() const { return bool(from_string_); }
+    std::any from_string(const std::string& s) const
+    {
+        assert(hasFromString());
+        return from_string_(s);
+    }
+    void setFromString(std::function<std::any(const std::string&)> fs)
+    {
+        from_string_ = fs;
+    }
+    // Utility template function to parse a string as a value of type T.
+    // Returns an empty std::any if the entire string is not a valid T.
+    template <typename T> static std::any any_from_string(const std::string& s)
+    {
+        T value{};
+        bool ok = false;
+        if constexpr (std::is_arithmetic_v<T>)
+        {
+            // Fast path for numbers, avoids constructing an istringstream.
+            char* end = nullptr;
+            if constexpr (std::is_integral_v<T>)
+                { value = T(std::strtoll(s.c_str(), &end, 10)); }
+            else
+                { value = T(std::strtod(s.c_str(), &end)); }
+            ok = !s.empty() && (end == s.c_str() + s.size());
+        }
+        else
+        {
+            std::istringstream stream(s);
+            stream >> value;
+            ok = !stream.fail() && (stream.peek() == EOF);
+        }
+        return ok ? std::any(value) : std::any();
+    }
     // Default max jiggle: a scale factor for magnitude of noise added to a
     // ranged numeric GpType by "jiggle mutation." Zero-centered noise added is
     // uniformly distributed on the interval [-m, +m] where m is: ((range_max -
@@ -138,10 +217,14 @@ public:
     }
 private:
     std::string name_;
+    int id_ = -1;
+    std::string cpp_type_name_;
     // Function to generate an ephemeral constant.
     std::function<std::any()> ephemeral_generator_ = nullptr;
     // Function to generate string representation of a value of this GpType.
     std::function<std::string(std::any a)> to_string_ = nullptr;
+    // Function to parse string representation of a value of this GpType.
+    std::function<std::any(const std::string&)> from_string_ = nullptr;
     // Function to jiggle/jitter an ephemeral constant.
     std::function<std::any(std::any)> jiggle_ = nullptr;
     // Pointers to (and names of) GpFunctions which return this type.
@@ -149,7 +232,63 @@ private:
     std::vector<std::string> names_of_functions_returning_this_type_;
     // Minimum "size" of tree returning this type from root;
     int min_size_to_terminate_ = std::numeric_limits<int>::max();
+    // Minimum evaluation cost of tree returning this type from root.
+    float min_cost_to_terminate_ = std::numeric_limits<float>::infinity();
     // Optional function to delete a heap-allocated value of this GpType, e.g.
     // instance constructed during GpTree::eval(). Called during ~Individual().
     std::function<void(std::any)> deleter_ = nullptr;
 };
+
+// A set of GpTypes, represented as a fixed width bitset indexed by GpType's
+// id(), so for example intersection is a single AND. A GpType without an ID
+// (not in a FunctionSet) or with an ID of max_types or more (in a FunctionSet
+// with more GpTypes than that) is kept in a slower std::set instead.
+class GpTypeSet
+{
+public:
+    static constexpr int max_types = 128;
+    GpTypeSet(){}
+    GpTypeSet(std::initializer_list<const GpType*> types)
+        { for (auto type : types) insert(type); }
+    void insert(const GpType* type)
+    {
+        assert(type);
+        if (inBitset(type)) { bits_.set(type->id()); }
+        else { others_.insert(type); }
+    }
+    bool contains(const GpType* type) const
+    {
+        return (inBitset(type) ? bits_.test(type->id()) :
+                (others_.find(type) != others_.end()));
+    }
+    bool empty() const { return bits_.none() && others_.empty(); }
+    size_t size() const { return bits_.count() + others_.size(); }
+    void clear() { bits_.reset(); others_.clear(); }
+    GpTypeSet operator&(const GpTypeSet& other) const
+    {
+        GpTypeSet result;
+        result.bits_ = bits_ & other.bits_;
+        for (auto type : others_)
+        {
+            if (other.others_.count(type)) { result.others_.insert(type); }
+        }
+        return result;
+    }
+    GpTypeSet operator|(const GpTypeSet& other) const
+    {
+        GpTypeSet result;
+        result.bits_ = bits_ | other.bits_;
+        result.others_ = others_;
+        result.others_.insert(other.others_.begin(), other.others_.end());
+        return result;
+    }
+    bool operator==(const GpTypeSet& other) const
+        { return (bits_ == other.bits_) && (others_ == other.others_); }
+private:
+    static bool inBitset(const GpType* type)
+    {
+        return (type->id() >= 0) && (type->id() < max_types);
+    }
+    std::bitset<max_types> bits_;
+    std::set<const GpType*> others_;
+};
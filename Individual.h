@@ -9,6 +9,9 @@
 #pragma once
 #include "Utilities.h"
 #include "FunctionSet.h"
+#include <atomic>
+
+class NativeProgram;  // Defined in NativeCode.h
 
 class Individual
 {
@@ -21,6 +24,11 @@ public:
     {
         fs.makeRandomTree(max_tree_size, tree_);
     }
+    Individual(int max_tree_size, float max_tree_cost, const FunctionSet& fs)
+      : Individual()
+    {
+        fs.makeRandomTree(max_tree_size, max_tree_cost, tree_);
+    }
     Individual(const GpTree& gp_tree) : Individual() { tree_ = gp_tree; }
 
     virtual ~Individual()
@@ -31,6 +39,18 @@ public:
         tree_.deleteCachedValues();
         destructor_count_++;
     }
+    // A copy of this Individual, whose storage is allocated by the calling
+    // thread (see NumaPlacement.h). Its tree is not yet evaluated: values
+    // cached in this Individual's tree belong to it, and are not copied.
+    Individual* relocatedCopy() const
+    {
+        Individual* copy = new Individual(*this);
+        constructor_count_++;
+        copy->tree_.forgetCachedValues();
+        copy->tree_evaluated_ = false;
+        copy->tree_eval_counter_ = 0;
+        return copy;
+    }
     // Read-only (const) access to this Individual's GpTree.
     const GpTree& tree() const { return tree_; }
     // Return/cache the result of running/evaluating this Individual's GpTree.
@@ -45,12 +65,42 @@ public:
         }
         return tree_.getRootValue();
     }
+    // Was an evaluation of this Individual stopped by an EvalBudget?
+    bool overBudget() const { return over_budget_; }
+    void setOverBudget(bool over_budget) { over_budget_ = over_budget; }
+    // Optional native code version of this Individual's tree, see
+    // NativeCompiler in NativeCode.h.
+    std::shared_ptr<const NativeProgram> nativeProgram() const
+        { return native_program_; }
+    void setNativeProgram(std::shared_ptr<const NativeProgram> program)
+        { native_program_ = program; }
     // Get/inc count of tournament Individual has survived (did not "lose").
     int getTournamentsSurvived() const { return tournaments_survived_; }
     void incrementTournamentsSurvived() { tournaments_survived_++; }
+    void setTournamentsSurvived(int count) { tournaments_survived_ = count; }
     // Added to support "absolute fitness" in addition to "tournament fitness".
     bool hasFitness() const { return has_fitness_; }
     void setFitness(float f) { fitness_ = f; has_fitness_ = true; }
+    // Forget cached fitness (so it will be measured again).
+    void clearFitness() { has_fitness_ = false; fitness_samples_ = 0; }
+    // For mini-batch fitness (see FitnessCaseSampler): cached fitness is an
+    // estimate, the average of "fitness_samples_" batch fitness values, where
+    // only the latest "window" samples are counted in full.
+    void updateFitnessEstimate(float batch_fitness, int window, int step)
+    {
+        float n = std::min(fitness_samples_, std::max(1, window) - 1);
+        float old = hasFitness() ? fitness_ : batch_fitness;
+        setFitness(((old * n) + batch_fitness) / (n + 1));
+        fitness_samples_++;
+        fitness_step_ = step;
+    }
+    // Average fitness of parents when this Individual was made by crossover,
+    // NaN if unknown. Used by SurrogateModel.
+    float getParentFitness() const { return parent_fitness_; }
+    void setParentFitness(float fitness) { parent_fitness_ = fitness; }
+    // Number of batches in the fitness estimate and step of latest one.
+    int fitnessSamples() const { return fitness_samples_; }
+    int fitnessStep() const { return fitness_step_; }
     //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 //        float getFitness() const { return (hasFitness() ?
 //                                           fitness_ :
@@ -92,6 +142,7 @@ public:
 
 //    int getStanding() const { return getTournamentsSurvived() + standing_; }
     int getStanding() const { return standing_; }
+    void setStanding(int standing) { standing_ = standing; }
     void adjustStandingForWinAgainst(const Individual& defeated)
     {
         standing_ = std::max(standing_, int(defeated.getFitness()));
@@ -121,6 +172,8 @@ private:
     bool tree_evaluated_ = false;
     // Make sure we don't eval() the tree more than once. (TODO Still needed?)
     int tree_eval_counter_ = 0;
+    std::shared_ptr<const NativeProgram> native_program_;
+    bool over_budget_ = false;
     // Number of tournament this Individual has survived (did not "lose").
     int tournaments_survived_ = 0;
     //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -133,7 +186,11 @@ private:
     // Added to support "absolute fitness" in addition to "tournament fitness".
     float fitness_ = 0;
     bool has_fitness_ = false;
+    int fitness_samples_ = 0;
+    float parent_fitness_ = std::numeric_limits<float>::quiet_NaN();
+    int fitness_step_ = 0;
     // Leak check. Count constructor/destructor calls. Must match at end of run.
-    static inline int constructor_count_ = 0;
-    static inline int destructor_count_ = 0;
+    // (Atomic since Individuals may be made on ThreadPool workers.)
+    static inline std::atomic<int> constructor_count_ = 0;
+    static inline std::atomic<int> destructor_count_ = 0;
 };
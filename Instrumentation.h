@@ -0,0 +1,361 @@
+//
+//  Instrumentation.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Low overhead timing of the phases of Population::evolutionStep(). Each phase
+// (tournament selection, crossover, and so on) is timed with a Scope object
+// and recorded into counters and a histogram of durations kept separately for
+// each thread, so recording never contends with other threads. Snapshots merge
+// all threads. Results can be printed or written as a CSV file, and (if event
+// tracing is enabled) a Chrome trace JSON file for chrome://tracing/Perfetto.
+// When not enabled, a Scope costs only a test of a bool.
+
+#pragma once
+#include "Utilities.h"
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// A small integer index for each live thread: the lowest not in use by
+// another thread. An index is reused after its thread exits.
+class ThreadIndex
+{
+public:
+    static int current()
+    {
+        thread_local Holder holder;
+        return holder.index;
+    }
+private:
+    struct Registry
+    {
+        std::mutex mutex;
+        std::set<int> free;
+        int next = 0;
+    };
+    static Registry& registry()
+    {
+        static Registry registry;
+        return registry;
+    }
+    struct Holder
+    {
+        int index = 0;
+        Holder()
+        {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            if (r.free.empty()) { index = r.next++; }
+            else { index = *r.free.begin(); r.free.erase(r.free.begin()); }
+        }
+        ~Holder()
+        {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.free.insert(index);
+        }
+    };
+};
+
+// Holds one instance of T for each thread which uses it. Each thread updates
+// its own instance, the union of all instances can be inspected at any time.
+// Instances are kept per ThreadIndex, so a thread which exits leaves its data
+// to the next thread given that index.
+template <typename T> class PerThread
+{
+public:
+    PerThread() { for (auto& slot : fast_slots_) { slot = nullptr; } }
+    // Copies start with no per-thread data.
+    PerThread(const PerThread&) : PerThread() {}
+    PerThread& operator=(const PerThread&) { return *this; }
+    // Apply "function" to the calling thread's instance of T.
+    template <typename F> void update(F function)
+    {
+        Slot& slot = localSlot();
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        function(slot.data);
+    }
+    // Apply "function" to the instance of T belonging to each thread.
+    template <typename F> void forEach(F function) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& slot : slots_)
+        {
+            std::lock_guard<std::mutex> slot_lock(slot->mutex);
+            function(const_cast<const T&>(slot->data), slot->index);
+        }
+    }
+    // Reset each thread's instance to a default constructed T.
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& slot : slots_)
+        {
+            std::lock_guard<std::mutex> slot_lock(slot->mutex);
+            slot->data = T();
+        }
+    }
+private:
+    struct Slot
+    {
+        int index = 0;  // ThreadIndex of thread using this Slot.
+        mutable std::mutex mutex;
+        T data;
+    };
+    // Find (or create) the calling thread's Slot. For the first
+    // fast_slots_.size() thread indices this is a lock-free array lookup.
+    Slot& localSlot()
+    {
+        int index = ThreadIndex::current();
+        bool fast = index < int(fast_slots_.size());
+        if (fast)
+        {
+            Slot* slot = fast_slots_[index].load(std::memory_order_acquire);
+            if (slot) { return *slot; }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot* slot = nullptr;
+        for (auto& s : slots_) { if (s->index == index) { slot = s.get(); } }
+        if (!slot)
+        {
+            slots_.push_back(std::make_unique<Slot>());
+            slot = slots_.back().get();
+            slot->index = index;
+        }
+        if (fast) { fast_slots_[index].store(slot, std::memory_order_release); }
+        return *slot;
+    }
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::array<std::atomic<Slot*>, 256> fast_slots_;
+};
+
+class Instrumentation
+{
+public:
+    // Phases of Population::evolutionStep(). Sort usually happens within
+    // Logging, since the sorted index is updated lazily when read.
+    enum Phase
+    {
+        TournamentSelection,
+        TournamentFunction,
+        Crossover,
+        Mutation,
+        TreeEvaluation,
+        Replacement,
+        Migration,
+        Sort,
+        Logging,
+        PhaseCount
+    };
+    static const char* phaseName(int phase)
+    {
+        static const char* names[PhaseCount] =
+        {
+            "tournament_selection", "tournament_function", "crossover",
+            "mutation", "tree_evaluation", "replacement", "migration",
+            "sort", "logging"
+        };
+        return names[phase];
+    }
+    typedef std::chrono::steady_clock Clock;
+
+    // Count, total/min/max time, and log2 histogram of durations for a phase.
+    class PhaseStats
+    {
+    public:
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        uint64_t min_ns = std::numeric_limits<uint64_t>::max();
+        uint64_t max_ns = 0;
+        // histogram[i] counts durations of at least 2^(i-1) and less than 2^i
+        // nanoseconds. (histogram[0] counts zero durations.)
+        std::array<uint64_t, 48> histogram = {};
+        void record(uint64_t ns)
+        {
+            count++;
+            total_ns += ns;
+            min_ns = std::min(min_ns, ns);
+            max_ns = std::max(max_ns, ns);
+            size_t bucket = 0;
+            while ((ns >> bucket) && (bucket < histogram.size() - 1)) bucket++;
+            histogram[bucket]++;
+        }
+        void merge(const PhaseStats& other)
+        {
+            count += other.count;
+            total_ns += other.total_ns;
+            min_ns = std::min(min_ns, other.min_ns);
+            max_ns = std::max(max_ns, other.max_ns);
+            for (size_t i = 0; i < histogram.size(); i++)
+                histogram[i] += other.histogram[i];
+        }
+        double meanNs() const { return count ? double(total_ns) / count : 0; }
+        // Approximate quantile (0 to 1) of durations, from histogram.
+        uint64_t quantileNs(double q) const
+        {
+            uint64_t target = uint64_t(std::ceil(q * count));
+            uint64_t sum = 0;
+            for (size_t i = 0; i < histogram.size(); i++)
+            {
+                sum += histogram[i];
+                if (count && (sum >= target))
+                    return std::min(max_ns, (uint64_t(1) << i) - 1);
+            }
+            return max_ns;
+        }
+    };
+    // Stats for all phases, merged over all threads.
+    typedef std::array<PhaseStats, PhaseCount> Report;
+
+    // RAII object which times its own lifetime as an instance of "phase".
+    class Scope
+    {
+    public:
+        Scope(Instrumentation& instrumentation, Phase phase)
+          : instrumentation_(instrumentation), phase_(phase)
+        {
+            if (instrumentation_.enabled()) start_ = Clock::now();
+        }
+        ~Scope()
+        {
+            if (instrumentation_.enabled() && (start_ != Clock::time_point()))
+            {
+                instrumentation_.record(phase_, start_, Clock::now());
+            }
+        }
+    private:
+        Instrumentation& instrumentation_;
+        Phase phase_;
+        Clock::time_point start_;
+    };
+
+    // Recording is off by default.
+    bool enabled() const { return enabled_; }
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    // Max number of individual timed events to keep (per thread) for writing
+    // a Chrome trace. Zero (the default) records statistics only.
+    void setTraceEventLimit(size_t limit) { trace_event_limit_ = limit; }
+
+    // Record one timed instance of a phase into calling thread's data.
+    void record(Phase phase, Clock::time_point start, Clock::time_point end)
+    {
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>
+            (end - start).count();
+        per_thread_.update([&](ThreadData& data)
+        {
+            data.phases[phase].record(ns);
+            if (data.events.size() < trace_event_limit_)
+            {
+                data.events.push_back({phase, start, end});
+            }
+        });
+    }
+
+    // Merge per-thread stats into a Report.
+    Report snapshot() const
+    {
+        Report report;
+        per_thread_.forEach([&](const ThreadData& data, int)
+        {
+            for (int p = 0; p < PhaseCount; p++)
+                report[p].merge(data.phases[p]);
+        });
+        return report;
+    }
+    // Discard all recorded stats and trace events.
+    void reset() { per_thread_.clear(); }
+
+    // Print a Report as a table, one row per phase.
+    static void print(const Report& report)
+    {
+        std::cout << "phase                  count   total ms   mean us";
+        std::cout << "    p50 us    p99 us    max us" << std::endl;
+        for (int p = 0; p < PhaseCount; p++)
+        {
+            const PhaseStats& s = report[p];
+            std::cout << std::left << std::setw(20) << phaseName(p);
+            std::cout << std::right << std::fixed << std::setprecision(2);
+            std::cout << std::setw(9) << s.count;
+            std::cout << std::setw(11) << s.total_ns / 1e6;
+            std::cout << std::setw(10) << s.meanNs() / 1e3;
+            std::cout << std::setw(10) << s.quantileNs(0.5) / 1e3;
+            std::cout << std::setw(10) << s.quantileNs(0.99) / 1e3;
+            std::cout << std::setw(10) << s.max_ns / 1e3 << std::endl;
+        }
+        std::cout << std::defaultfloat;
+    }
+    // Write snapshot() as a CSV file, one row per phase. Returns false if the
+    // file could not be written.
+    bool writeCSV(const std::string& pathname) const
+    {
+        Report report = snapshot();
+        std::ofstream stream(pathname);
+        stream << "phase,count,total_ns,mean_ns,min_ns,p50_ns,p90_ns,p99_ns,";
+        stream << "max_ns" << std::endl;
+        for (int p = 0; p < PhaseCount; p++)
+        {
+            const PhaseStats& s = report[p];
+            stream << phaseName(p) << "," << s.count << "," << s.total_ns;
+            stream << "," << uint64_t(s.meanNs());
+            stream << "," << (s.count ? s.min_ns : 0);
+            stream << "," << s.quantileNs(0.5) << "," << s.quantileNs(0.9);
+            stream << "," << s.quantileNs(0.99) << "," << s.max_ns;
+            stream << std::endl;
+        }
+        return bool(stream);
+    }
+    // Write recorded trace events in Chrome trace event JSON format. Returns
+    // false if the file could not be written.
+    bool writeChromeTrace(const std::string& pathname) const
+    {
+        std::ofstream stream(pathname);
+        stream << "{\"traceEvents\":[";
+        bool comma = false;
+        per_thread_.forEach([&](const ThreadData& data, int thread)
+        {
+            for (auto& event : data.events)
+            {
+                auto us = [](Clock::time_point t)
+                {
+                    auto d = t.time_since_epoch();
+                    return std::chrono::duration<double, std::micro>(d).count();
+                };
+                stream << (comma ? ",\n" : "\n");
+                comma = true;
+                stream << std::fixed << std::setprecision(3);
+                stream << "{\"name\":\"" << phaseName(event.phase) << "\",";
+                stream << "\"cat\":\"LazyPredator\",\"ph\":\"X\",";
+                stream << "\"ts\":" << us(event.start) << ",";
+                stream << "\"dur\":" << us(event.end) - us(event.start) << ",";
+                stream << "\"pid\":1,\"tid\":" << thread << "}";
+            }
+        });
+        stream << "\n]}" << std::endl;
+        return bool(stream);
+    }
+private:
+    struct TraceEvent
+    {
+        Phase phase;
+        Clock::time_point start;
+        Clock::time_point end;
+    };
+    struct ThreadData
+    {
+        std::array<PhaseStats, PhaseCount> phases;
+        std::vector<TraceEvent> events;
+    };
+    std::atomic<bool> enabled_ = false;
+    std::atomic<size_t> trace_event_limit_ = 0;
+    PerThread<ThreadData> per_thread_;
+};
@@ -0,0 +1,587 @@
+//
+//  IslandNetwork.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Multi-process island model. Several processes on one host, each evolving
+// its own Population (an "island"), exchange migrant Individuals through a
+// small IslandCoordinator, over Unix domain sockets. Scaling to more processes
+// is then a matter of starting more of them.
+//
+// Each process makes an IslandClient for its Population, which joins the
+// coordinator and gets an island ID. IslandClient::run() runs evolution steps,
+// and every migrationInterval() steps sends copies of migrantCount() random
+// Individuals (GpTree, fitness, tournaments survived) and takes in migrants
+// sent to it, each replacing a random Individual. The coordinator forwards
+// migrants around a ring of islands in order of joining.
+//
+// Checkpoints are coordinated: IslandCoordinator::requestCheckpoint() asks
+// each island to write a PopulationSnapshot into a given directory, at its
+// next exchange, and checkpointComplete() says when all have done so.
+//
+// Messages are WireFormat messages, framed by a 32 bit length. Trees are sent
+// as in WireFormat.h, so leaf GpTypes need to_string and from_string. The
+// coordinator does not need a FunctionSet, it forwards migrants verbatim. It
+// never waits to send: each island has a queue of output, sent as the island
+// reads it, so a slow island cannot stall the others. When an island's queue
+// is full, migrants to it are dropped. A peer which sends a frame longer than
+// MessageSocket::maxMessageSize() is disconnected.
+
+#pragma once
+#include "PopulationSnapshot.h"
+#include "WireFormat.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// A connected stream socket which sends and receives length-framed messages.
+class MessageSocket
+{
+public:
+    enum Type : int32_t
+    {
+        Join = 1,        // island -> coordinator
+        Welcome,         // coordinator -> island: island ID
+        Migrants,        // island -> coordinator -> island
+        Checkpoint,      // coordinator -> island: epoch, directory
+        CheckpointDone,  // island -> coordinator: epoch, ok
+    };
+    MessageSocket(int fd = -1) : fd_(fd) {}
+    ~MessageSocket() { close(); }
+    MessageSocket(const MessageSocket&) = delete;
+    MessageSocket& operator=(const MessageSocket&) = delete;
+    int fd() const { return fd_; }
+    bool valid() const { return fd_ >= 0; }
+    void close()
+    {
+        if (fd_ >= 0) { ::close(fd_); }
+        fd_ = -1;
+    }
+    // Connect to Unix domain socket at "pathname". Check valid() after.
+    bool connect(const std::string& pathname)
+    {
+        close();
+        sockaddr_un address;
+        if (!socketAddress(pathname, address)) return false;
+        fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (valid() &&
+            (::connect(fd_, reinterpret_cast<sockaddr*>(&address),
+                       sizeof(address)) != 0))
+        {
+            close();
+        }
+        return valid();
+    }
+    // Largest message sent or received (64 MB), and most output queued.
+    static constexpr size_t maxMessageSize() { return 1 << 26; }
+    static constexpr size_t maxQueuedBytes() { return 4 * maxMessageSize(); }
+    // Send one message, waiting until it is sent. Returns false if the
+    // connection is closed, or the message is too large.
+    bool send(const std::string& message)
+    {
+        if (!post(message)) return false;
+        while (hasOutput())
+        {
+            pollfd fd = {fd_, POLLOUT, 0};
+            ::poll(&fd, 1, -1);
+            if (!flush()) return false;
+        }
+        return true;
+    }
+    // Queue one message, to be sent by flush(), without waiting. Returns false
+    // if the connection is closed, the message is too large, or the queue is
+    // full.
+    bool post(const std::string& message)
+    {
+        uint32_t size = uint32_t(message.size());
+        if (!valid() || (message.size() > maxMessageSize()) ||
+            (queuedBytes() + sizeof(size) + size > maxQueuedBytes()))
+        {
+            return false;
+        }
+        output_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        output_ += message;
+        return true;
+    }
+    // Send as much queued output as can be sent without waiting. Returns false
+    // if the connection is closed.
+    bool flush()
+    {
+        while (valid() && hasOutput())
+        {
+            ssize_t n = ::send(fd_, output_.data() + output_sent_,
+                               queuedBytes(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) { output_sent_ += n; }
+            else if ((n < 0) && (errno == EINTR)) { continue; }
+            else { return (n < 0) && ((errno == EAGAIN) ||
+                                      (errno == EWOULDBLOCK)); }
+        }
+        output_.clear();
+        output_sent_ = 0;
+        return valid();
+    }
+    // Is queued output waiting to be sent, and how much?
+    bool hasOutput() const { return queuedBytes() > 0; }
+    size_t queuedBytes() const { return output_.size() - output_sent_; }
+    // Read whatever has arrived (without blocking), append each complete
+    // message to "messages". Returns false if connection was closed, or (then
+    // closing it) a frame was longer than maxMessageSize().
+    bool receive(std::vector<std::string>& messages)
+    {
+        char buffer[65536];
+        bool open = valid();
+        while (open)
+        {
+            ssize_t n = recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n > 0) { input_.append(buffer, n); }
+            else if ((n < 0) && (errno == EINTR)) { continue; }
+            else
+            {
+                open = (n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK));
+                break;
+            }
+        }
+        uint32_t size = 0;
+        while (input_.size() >= sizeof(size))
+        {
+            std::memcpy(&size, input_.data(), sizeof(size));
+            if (size > maxMessageSize())
+            {
+                input_.clear();
+                close();
+                return false;
+            }
+            if (input_.size() < sizeof(size) + size) break;
+            messages.push_back(input_.substr(sizeof(size), size));
+            input_.erase(0, sizeof(size) + size);
+        }
+        return open;
+    }
+    // Wait up to "milliseconds" for input. Returns true if some is available.
+    bool wait(int milliseconds) const
+    {
+        pollfd fd = {fd_, POLLIN, 0};
+        return (poll(&fd, 1, milliseconds) > 0);
+    }
+    // Set "address" for a socket at "pathname". Returns false if pathname is
+    // empty or too long for a Unix domain socket.
+    static bool socketAddress(const std::string& pathname,
+                              sockaddr_un& address)
+    {
+        address = {};
+        address.sun_family = AF_UNIX;
+        if (pathname.empty() ||
+            (pathname.size() >= sizeof(address.sun_path))) return false;
+        std::strncpy(address.sun_path, pathname.c_str(),
+                     sizeof(address.sun_path) - 1);
+        return true;
+    }
+private:
+    int fd_ = -1;
+    std::string input_;
+    // Queued output, of which the first output_sent_ bytes have been sent.
+    std::string output_;
+    size_t output_sent_ = 0;
+};
+
+class IslandCoordinator
+{
+public:
+    // Listen on a Unix domain socket at "pathname". Check valid() after, which
+    // is false if the pathname is too long, names a file which is not a
+    // socket, or names the socket of a coordinator which is still running.
+    IslandCoordinator(const std::string& pathname) : pathname_(pathname)
+    {
+        sockaddr_un address;
+        int fd = -1;
+        if (MessageSocket::socketAddress(pathname, address) &&
+            removeStaleSocketFile(pathname, address))
+        {
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        }
+        if ((fd >= 0) &&
+            ((bind(fd, reinterpret_cast<sockaddr*>(&address),
+                   sizeof(address)) != 0) ||
+             (listen(fd, 64) != 0)))
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        listener_ = std::make_unique<MessageSocket>(fd);
+    }
+    ~IslandCoordinator()
+    {
+        stop();
+        if (valid()) { removeSocketFile(pathname_); }
+        listener_->close();
+    }
+    bool valid() const { return listener_->valid(); }
+    const std::string& pathname() const { return pathname_; }
+
+    // Serve on a new thread, until stop(). (Or call serve() or poll().)
+    void start()
+    {
+        stop();
+        running_ = true;
+        thread_ = std::thread([this](){ while (running_) { poll(50); } });
+    }
+    void stop()
+    {
+        running_ = false;
+        if (thread_.joinable()) { thread_.join(); }
+    }
+    // Serve until stop() is called (from another thread).
+    void serve()
+    {
+        running_ = true;
+        while (running_) { poll(50); }
+    }
+    // Wait up to "milliseconds" for connections and messages, handle those.
+    void poll(int milliseconds)
+    {
+        std::vector<pollfd> fds = {{listener_->fd(), POLLIN, 0}};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& island : islands_)
+            {
+                short events = POLLIN;
+                if (island.socket->hasOutput()) { events |= POLLOUT; }
+                fds.push_back({island.socket->fd(), events, 0});
+            }
+        }
+        if (::poll(fds.data(), fds.size(), milliseconds) <= 0) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept(listener_->fd(), nullptr, nullptr);
+            if (fd >= 0)
+            {
+                islands_.push_back({next_id_++,
+                                    std::make_unique<MessageSocket>(fd)});
+            }
+        }
+        std::vector<int> closed;
+        for (size_t i = 1; i < fds.size(); i++)
+        {
+            if (!fds[i].revents) continue;
+            Island& island = islands_.at(i - 1);
+            std::vector<std::string> messages;
+            if (!island.socket->receive(messages))
+            {
+                closed.push_back(island.id);
+            }
+            for (auto& message : messages) { handle(island, message); }
+        }
+        // Send queued output (without waiting).
+        for (auto& island : islands_)
+        {
+            if (!island.socket->flush()) { closed.push_back(island.id); }
+        }
+        for (int id : closed) { remove(id); }
+    }
+
+    // Number of islands connected.
+    int islandCount() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return int(islands_.size());
+    }
+    // Number of migrants forwarded from one island to another.
+    int64_t migrantsForwarded() const { return migrants_forwarded_; }
+
+    // Ask each island to write a checkpoint into "directory" (which must
+    // exist). Returns the checkpoint's epoch number.
+    int requestCheckpoint(const std::string& directory)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int epoch = ++epoch_;
+        WireWriter writer;
+        writer.write(int32_t(MessageSocket::Checkpoint));
+        writer.write(int32_t(epoch));
+        writer.writeString(directory);
+        for (auto& island : islands_)
+        {
+            if (island.socket->post(writer.message()))
+            {
+                checkpoints_[epoch].pending.insert(island.id);
+                island.socket->flush();
+            }
+        }
+        checkpoints_[epoch];  // In case there are no islands.
+        return epoch;
+    }
+    // Have all islands (connected at request) written checkpoint "epoch"?
+    bool checkpointComplete(int epoch) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = checkpoints_.find(epoch);
+        return (it != checkpoints_.end()) && it->second.pending.empty();
+    }
+    // Did they all succeed? (False if any island failed or left.)
+    bool checkpointOk(int epoch) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = checkpoints_.find(epoch);
+        return (it != checkpoints_.end()) && it->second.ok;
+    }
+
+private:
+    struct Island
+    {
+        int id;
+        std::unique_ptr<MessageSocket> socket;
+    };
+    struct CheckpointState
+    {
+        std::set<int> pending;
+        bool ok = true;
+    };
+    void handle(Island& island, const std::string& message)
+    {
+        WireReader reader(message);
+        int32_t type = reader.read<int32_t>();
+        if (type == MessageSocket::Join)
+        {
+            WireWriter writer;
+            writer.write(int32_t(MessageSocket::Welcome));
+            writer.write(int32_t(island.id));
+            island.socket->post(writer.message());
+        }
+        else if (type == MessageSocket::Migrants)
+        {
+            // Forward to next island in ring, if any.
+            reader.read<int32_t>();
+            uint32_t count = reader.read<uint32_t>();
+            if ((islands_.size() > 1) && reader.ok())
+            {
+                size_t i = 0;
+                while (islands_[i].id != island.id) { i++; }
+                Island& next = islands_[(i + 1) % islands_.size()];
+                if (next.socket->post(message))
+                {
+                    migrants_forwarded_ += count;
+                }
+            }
+        }
+        else if (type == MessageSocket::CheckpointDone)
+        {
+            int32_t epoch = reader.read<int32_t>();
+            bool ok = reader.read<uint8_t>() && reader.ok();
+            auto it = checkpoints_.find(epoch);
+            if (it != checkpoints_.end() && it->second.pending.count(island.id))
+            {
+                it->second.pending.erase(island.id);
+                if (!ok) { it->second.ok = false; }
+            }
+        }
+    }
+    // Remove socket file at "pathname". Returns false if some other kind of
+    // file is there.
+    static bool removeSocketFile(const std::string& pathname)
+    {
+        struct stat status;
+        if (lstat(pathname.c_str(), &status) != 0) { return errno == ENOENT; }
+        return S_ISSOCK(status.st_mode) && (::unlink(pathname.c_str()) == 0);
+    }
+    // Remove a socket file left at "pathname" by a coordinator which exited,
+    // known by its connections being refused. Returns false if the socket is
+    // still accepting connections, or some other kind of file is there.
+    static bool removeStaleSocketFile(const std::string& pathname,
+                                      const sockaddr_un& address)
+    {
+        struct stat status;
+        if (lstat(pathname.c_str(), &status) != 0) { return errno == ENOENT; }
+        if (!S_ISSOCK(status.st_mode)) { return false; }
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) { return false; }
+        bool refused = ((::connect(fd,
+                                   reinterpret_cast<const sockaddr*>(&address),
+                                   sizeof(address)) != 0) &&
+                        (errno == ECONNREFUSED));
+        ::close(fd);
+        return refused && removeSocketFile(pathname);
+    }
+    // Island has left: forget it, fail its pending checkpoints.
+    void remove(int id)
+    {
+        for (auto& [epoch, checkpoint] : checkpoints_)
+        {
+            if (checkpoint.pending.erase(id)) { checkpoint.ok = false; }
+        }
+        islands_.erase(std::remove_if(islands_.begin(), islands_.end(),
+                                      [&](const Island& island)
+                                      { return island.id == id; }),
+                       islands_.end());
+    }
+    std::string pathname_;
+    std::unique_ptr<MessageSocket> listener_;
+    std::vector<Island> islands_;
+    int next_id_ = 0;
+    int epoch_ = 0;
+    std::map<int, CheckpointState> checkpoints_;
+    std::atomic<int64_t> migrants_forwarded_ = 0;
+    std::atomic<bool> running_ = false;
+    std::thread thread_;
+    mutable std::mutex mutex_;
+};
+
+class IslandClient
+{
+public:
+    // Join the coordinator listening at "pathname", with "population" as this
+    // process's island. Waits up to "timeout_ms" for the coordinator's reply.
+    // Check connected() after.
+    IslandClient(const std::string& pathname,
+                 Population& population,
+                 int timeout_ms = 5000)
+      : population_(population)
+    {
+        if (!socket_.connect(pathname)) return;
+        WireWriter writer;
+        writer.write(int32_t(MessageSocket::Join));
+        socket_.send(writer.message());
+        std::vector<std::string> messages;
+        while (socket_.wait(timeout_ms) && socket_.receive(messages) &&
+               messages.empty()) {}
+        std::string welcome = messages.empty() ? "" : messages.front();
+        WireReader reader(welcome);
+        if (reader.read<int32_t>() == MessageSocket::Welcome)
+        {
+            island_id_ = reader.read<int32_t>();
+        }
+        if (!reader.ok()) { socket_.close(); }
+        // Keep any messages that arrived after Welcome.
+        for (size_t i = 1; i < messages.size(); i++)
+        {
+            pending_.push_back(messages[i]);
+        }
+    }
+    bool connected() const { return socket_.valid(); }
+    int islandId() const { return island_id_; }
+
+    // Steps between exchanges (default 100), and migrants sent per exchange
+    // (default 1).
+    int migrationInterval() const { return migration_interval_; }
+    void setMigrationInterval(int steps) { migration_interval_ = steps; }
+    int migrantCount() const { return migrant_count_; }
+    void setMigrantCount(int count) { migrant_count_ = count; }
+
+    // Run "steps" evolution steps with "function" (any kind accepted by
+    // Population::evolutionStep()), calling exchange() every
+    // migrationInterval() steps.
+    template <typename F> void run(int steps, F function)
+    {
+        for (int i = 0; i < steps; i++)
+        {
+            population_.evolutionStep(function);
+            if (((i + 1) % migration_interval_) == 0) { exchange(); }
+        }
+    }
+    // Send migrants, then handle messages that have arrived.
+    void exchange()
+    {
+        sendMigrants(migrant_count_);
+        receive();
+    }
+    // Send copies of "count" randomly selected Individuals.
+    void sendMigrants(int count)
+    {
+        if (!connected() || (count <= 0)) return;
+        WireWriter writer;
+        writer.write(int32_t(MessageSocket::Migrants));
+        writer.write(int32_t(island_id_));
+        writer.write(uint32_t(count));
+        for (int i = 0; i < count; i++)
+        {
+            int s = LPRS().randomN(population_.getSubpopulationCount());
+            const Population::SubPop& subpop = population_.subpopulation(s);
+            Individual* individual = subpop.at(LPRS().randomN(subpop.size()));
+            writer.write(individual->getFitness());
+            writer.write(uint8_t(individual->hasFitness()));
+            writer.write(int32_t(individual->getTournamentsSurvived()));
+            writer.writeTree(individual->tree());
+        }
+        if (socket_.send(writer.message())) { migrants_sent_ += count; }
+    }
+    // Handle all messages that have arrived: migrants replace random
+    // Individuals, checkpoint requests are written and acknowledged.
+    void receive()
+    {
+        std::vector<std::string> messages;
+        std::swap(messages, pending_);
+        if (connected() && !socket_.receive(messages)) { socket_.close(); }
+        for (auto& message : messages) { handle(message); }
+    }
+
+    // Pathname of the checkpoint for an island and epoch in "directory".
+    static std::string checkpointPathname(const std::string& directory,
+                                          int island_id,
+                                          int epoch)
+    {
+        return (directory + "/island_" + std::to_string(island_id) +
+                "_epoch_" + std::to_string(epoch) + ".lpsnap");
+    }
+
+    // Counts of migrants sent and received, and checkpoints written.
+    int migrantsSent() const { return migrants_sent_; }
+    int migrantsReceived() const { return migrants_received_; }
+    int checkpointsWritten() const { return checkpoints_written_; }
+
+private:
+    void handle(const std::string& message)
+    {
+        WireReader reader(message);
+        int32_t type = reader.read<int32_t>();
+        if (type == MessageSocket::Migrants)
+        {
+            reader.read<int32_t>();
+            uint32_t count = reader.read<uint32_t>();
+            for (uint32_t i = 0; reader.ok() && (i < count); i++)
+            {
+                float fitness = reader.read<float>();
+                bool has_fitness = reader.read<uint8_t>();
+                int tournaments_survived = reader.read<int32_t>();
+                GpTree tree;
+                reader.readTree(*population_.getFunctionSet(), tree);
+                if (!reader.ok()) break;
+                int s = LPRS().randomN(population_.getSubpopulationCount());
+                Individual* migrant = population_.insertMigrant(s,
+                                                                tree,
+                                                                has_fitness,
+                                                                fitness);
+                migrant->setTournamentsSurvived(tournaments_survived);
+                migrants_received_++;
+            }
+        }
+        else if (type == MessageSocket::Checkpoint)
+        {
+            int32_t epoch = reader.read<int32_t>();
+            std::string directory = reader.readString();
+            bool ok = (reader.ok() &&
+                       PopulationSnapshot::write(population_,
+                                                 checkpointPathname(directory,
+                                                                    island_id_,
+                                                                    epoch)));
+            if (ok) { checkpoints_written_++; }
+            WireWriter writer;
+            writer.write(int32_t(MessageSocket::CheckpointDone));
+            writer.write(int32_t(epoch));
+            writer.write(uint8_t(ok));
+            socket_.send(writer.message());
+        }
+    }
+    Population& population_;
+    MessageSocket socket_;
+    int island_id_ = -1;
+    std::vector<std::string> pending_;
+    int migration_interval_ = 100;
+    int migrant_count_ = 1;
+    int migrants_sent_ = 0;
+    int migrants_received_ = 0;
+    int checkpoints_written_ = 0;
+};
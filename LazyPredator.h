@@ -9,4 +9,13 @@
 #pragma once
 
 #include "Population.h"
+#include "GpTreeParser.h"
+#include "PopulationSnapshot.h"
+#include "EvalPlan.h"
+#include "NativeCode.h"
+#include "EvalWorkers.h"
+#include "Racing.h"
+#include "FitnessCaseDataset.h"
+#include "IslandNetwork.h"
+#include "Coevolution.h"
 #include "UnitTests.h"
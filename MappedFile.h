@@ -0,0 +1,89 @@
+//
+//  MappedFile.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// A file mapped read-only into memory (via POSIX mmap()) for the lifetime of a
+// MappedFile instance. Used to read large binary files (such as a Population
+// snapshot) in place, without copying or parsing them into other structures.
+
+#pragma once
+#include "Utilities.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+class MappedFile
+{
+public:
+    MappedFile(){}
+    // Map the file at "pathname". Check valid() to see if that succeeded.
+    MappedFile(const std::string& pathname) { open(pathname); }
+    ~MappedFile() { close(); }
+    // Not copyable (owns the mapping) but can be moved.
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other)
+    {
+        if (this != &other)
+        {
+            close();
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+            pathname_ = other.pathname_;
+        }
+        return *this;
+    }
+    // Map the named file read-only, replacing any existing mapping.
+    bool open(const std::string& pathname)
+    {
+        close();
+        pathname_ = pathname;
+        int fd = ::open(pathname.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat file_status;
+        if ((fstat(fd, &file_status) == 0) && (file_status.st_size > 0))
+        {
+            void* address = mmap(nullptr, file_status.st_size,
+                                 PROT_READ, MAP_SHARED, fd, 0);
+            if (address != MAP_FAILED)
+            {
+                data_ = static_cast<const uint8_t*>(address);
+                size_ = size_t(file_status.st_size);
+            }
+        }
+        // Mapping stays valid after the file descriptor is closed.
+        ::close(fd);
+        return valid();
+    }
+    // Unmap file, if any.
+    void close()
+    {
+        if (data_) { munmap(const_cast<uint8_t*>(data_), size_); }
+        data_ = nullptr;
+        size_ = 0;
+    }
+    // Was file successfully mapped?
+    bool valid() const { return data_ != nullptr; }
+    // Address of first byte of file, and size of file in bytes.
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    const std::string& pathname() const { return pathname_; }
+    // Pointer to an object of type T at "offset" bytes from start of file,
+    // or nullptr if "count" of those objects would extend past end of file.
+    template <typename T> const T* at(size_t offset, size_t count = 1) const
+    {
+        bool ok = valid() && (offset <= size_) &&
+                  (count <= (size_ - offset) / sizeof(T));
+        return ok ? reinterpret_cast<const T*>(data_ + offset) : nullptr;
+    }
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    std::string pathname_;
+};
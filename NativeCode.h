@@ -0,0 +1,326 @@
+//
+//  NativeCode.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Native code generation for programs evaluated many times, for example a
+// champion validated on a large held-out data set. NativeCompiler writes a
+// GpTree as C++ source, using each GpFunction's codeTemplate() and each leaf
+// GpType's cppTypeName(), compiles it with the system compiler into a shared
+// library, and loads that with dlopen() as a NativeProgram.
+//
+// Code templates are C++ expressions with parameters written $0, $1, ... and
+// may refer to "context", an untyped const pointer passed to each eval(), for
+// example to the current fitness case. Helper functions and #includes can be
+// supplied in prelude(). Compiled programs are cached, keyed by a hash of their
+// source code, both in memory and as libraries in cacheDirectory() which are
+// reused by later runs. An Individual can hold its NativeProgram.
+//
+// Since cached libraries are loaded into this process, cacheDirectory() must
+// be private: it is created with mode 0700, and compile() fails unless it is a
+// directory owned by this user with no group or other permissions. The default
+// is in $XDG_CACHE_HOME or ~/.cache (or a per-user directory in /tmp). Each
+// library's source is stored beside it, and a cached library is used only if
+// that source matches, otherwise it is rebuilt.
+//
+// Uses POSIX dlopen(), so requires Linux or macOS and a C++ compiler at run
+// time. Failures (no code template, compile error) are reported by returning
+// nullptr, with a description in errorMessage().
+
+#pragma once
+#include "Individual.h"
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+
+// A GpTree compiled to native code in a shared library loaded with dlopen().
+class NativeProgram
+{
+public:
+    // Signature of the generated function: "context" is passed through to
+    // code templates, the root value is written to "result".
+    typedef void (*Function)(const void* context, void* result);
+    NativeProgram(void* handle, Function function, size_t hash)
+      : handle_(handle), function_(function), hash_(hash) {}
+    ~NativeProgram() { dlclose(handle_); }
+    NativeProgram(const NativeProgram&) = delete;
+    NativeProgram& operator=(const NativeProgram&) = delete;
+    // Evaluate program. T must be the C++ type of its root GpType.
+    template <typename T> T eval(const void* context = nullptr) const
+    {
+        T result{};
+        function_(context, &result);
+        return result;
+    }
+    // Hash of generated source code, also used in file names.
+    size_t hash() const { return hash_; }
+private:
+    void* handle_ = nullptr;
+    Function function_ = nullptr;
+    size_t hash_ = 0;
+};
+
+class NativeCompiler
+{
+public:
+    NativeCompiler() : cache_directory_(defaultCacheDirectory()) {}
+    // C++ source placed before generated code: #includes, helper functions.
+    const std::string& prelude() const { return prelude_; }
+    void setPrelude(const std::string& prelude) { prelude_ = prelude; }
+    // Shell command to compile a shared library. " -o <library> <source>" is
+    // appended (with quoted paths).
+    const std::string& compileCommand() const { return compile_command_; }
+    void setCompileCommand(const std::string& c) { compile_command_ = c; }
+    // Private directory for generated source files and compiled libraries.
+    const std::string& cacheDirectory() const { return cache_directory_; }
+    void setCacheDirectory(const std::string& d) { cache_directory_ = d; }
+
+    // Generate C++ source code for a GpTree, or empty string on failure.
+    std::string generateSource(const GpTree& tree)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return generate(tree);
+    }
+
+    // Compile a GpTree to a NativeProgram, or find one in the cache. Returns
+    // nullptr on failure.
+    std::shared_ptr<const NativeProgram> compile(const GpTree& tree)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_message_.clear();
+        std::string source = generate(tree);
+        if (source.empty()) { return nullptr; }
+        auto it = programs_.find(source);
+        if (it != programs_.end()) { cache_hits_++; return it->second; }
+        size_t hash = std::hash<std::string>()(compileCommand() + source);
+        std::stringstream ss;
+        ss << "lp_" << std::hex << std::setw(16) << std::setfill('0') << hash;
+        std::filesystem::path dir(cacheDirectory());
+        if (!privateDirectory(dir)) { return nullptr; }
+        std::string library = (dir / (ss.str() + ".so")).string();
+        std::string library_source = (dir / (ss.str() + ".cpp")).string();
+        if (!(std::filesystem::exists(library) &&
+              fileContents(library_source) == source) &&
+            !build(source, dir, ss.str(), library, library_source))
+        {
+            return nullptr;
+        }
+        void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) { error_message_ = dlerror(); return nullptr; }
+        auto function = reinterpret_cast<NativeProgram::Function>
+            (dlsym(handle, functionName()));
+        if (!function)
+        {
+            error_message_ = dlerror();
+            dlclose(handle);
+            return nullptr;
+        }
+        auto program = std::make_shared<NativeProgram>(handle, function, hash);
+        programs_[source] = program;
+        return program;
+    }
+    // Compile an Individual's tree and set its nativeProgram(). Returns true
+    // on success.
+    bool compile(Individual& individual)
+    {
+        auto program = compile(individual.tree());
+        if (program) { individual.setNativeProgram(program); }
+        return bool(program);
+    }
+
+    // Description of most recent failure.
+    const std::string& errorMessage() const { return error_message_; }
+    // Number of libraries built by the compiler, and of in-memory cache hits.
+    int compilations() const { return compilations_; }
+    int cacheHits() const { return cache_hits_; }
+    // Forget (and unload, when not otherwise referenced) cached programs.
+    void clearCache()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        programs_.clear();
+    }
+
+private:
+    static const char* functionName() { return "lazy_predator_native_eval"; }
+    // In $XDG_CACHE_HOME or ~/.cache, else in /tmp with user id in its name.
+    static std::string defaultCacheDirectory()
+    {
+        std::filesystem::path dir;
+        const char* xdg = std::getenv("XDG_CACHE_HOME");
+        const char* home = std::getenv("HOME");
+        if (xdg && *xdg) { dir = xdg; }
+        else if (home && *home) { dir = std::string(home) + "/.cache"; }
+        if (!dir.empty()) { return (dir / "lazy_predator_native").string(); }
+        dir = std::filesystem::temp_directory_path();
+        return (dir / ("lazy_predator_native_" +
+                       std::to_string(geteuid()))).string();
+    }
+    // Make "dir" (mode 0700) if needed, then check that it is a directory
+    // (not a symbolic link) owned by this user, with no group or other
+    // permissions. Otherwise set error_message_ and return false.
+    bool privateDirectory(const std::filesystem::path& dir)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(dir.parent_path(), error);
+        mkdir(dir.c_str(), 0700);
+        struct stat info;
+        if ((lstat(dir.c_str(), &info) != 0) || !S_ISDIR(info.st_mode) ||
+            (info.st_uid != geteuid()) || ((info.st_mode & 077) != 0))
+        {
+            error_message_ = "cache directory " + dir.string() +
+                             " must be a directory owned by this user with" +
+                             " mode 0700";
+            return false;
+        }
+        return true;
+    }
+    // Contents of a file, or empty string if it cannot be read.
+    static std::string fileContents(const std::string& pathname)
+    {
+        std::ifstream stream(pathname, std::ios::binary);
+        std::stringstream ss;
+        ss << stream.rdbuf();
+        return ss.str();
+    }
+    // Quote a string as one word for the shell.
+    static std::string shellQuote(const std::string& s)
+    {
+        std::string quoted = "'";
+        for (char c : s)
+        {
+            if (c == '\'') { quoted += "'\\''"; } else { quoted += c; }
+        }
+        return quoted + "'";
+    }
+    // Generate source, or set error_message_ and return empty string.
+    std::string generate(const GpTree& tree)
+    {
+        std::string expression;
+        const GpType* type = tree.getRootType();
+        if (type->cppTypeName().empty())
+        {
+            error_message_ = "GpType " + type->name() + " has no cppTypeName";
+            return "";
+        }
+        if (!generateExpression(tree, expression)) { return ""; }
+        std::stringstream ss;
+        ss << prelude() << std::endl;
+        ss << "extern \"C\" void " << functionName();
+        ss << "(const void* context, void* result)" << std::endl;
+        ss << "{" << std::endl;
+        ss << "    *static_cast<" << type->cppTypeName() << "*>(result) =";
+        ss << std::endl << "        " << expression << ";" << std::endl;
+        ss << "}" << std::endl;
+        return ss.str();
+    }
+    // Append C++ expression for subtree to "code", return false on failure.
+    bool generateExpression(const GpTree& tree, std::string& code)
+    {
+        if (tree.isLeaf())
+        {
+            const GpType& type = *tree.getRootType();
+            if (type.cppTypeName().empty() || !type.hasToString())
+            {
+                error_message_ = "GpType " + type.name() +
+                                 " has no cppTypeName or to_string";
+                return false;
+            }
+            // Exact (hexadecimal for floating point) literal of leaf value.
+            code += type.cppTypeName() + "(" +
+                    type.identityString(tree.getRootValue()) + ")";
+            return true;
+        }
+        const GpFunction& function = tree.getRootFunction();
+        const std::string& code_template = function.codeTemplate();
+        if (code_template.empty())
+        {
+            error_message_ = "GpFunction " + function.name() +
+                             " has no codeTemplate";
+            return false;
+        }
+        for (size_t i = 0; i < code_template.size(); i++)
+        {
+            char c = code_template[i];
+            if ((c == '$') && (i + 1 < code_template.size()) &&
+                std::isdigit(code_template[i + 1]))
+            {
+                size_t parameter = 0;
+                while ((i + 1 < code_template.size()) &&
+                       std::isdigit(code_template[i + 1]))
+                {
+                    parameter = parameter * 10 + (code_template[++i] - '0');
+                }
+                assert(parameter < tree.subtrees().size());
+                code += "(";
+                if (!generateExpression(tree.getSubtree(int(parameter)), code))
+                {
+                    return false;
+                }
+                code += ")";
+            }
+            else
+            {
+                code += c;
+            }
+        }
+        return true;
+    }
+    // Write source, run compiler, return false on failure. Compiles to a
+    // temporary file then renames (library, then its source) so other
+    // processes never load a partly written library.
+    bool build(const std::string& source,
+               const std::filesystem::path& dir,
+               const std::string& base_name,
+               const std::string& library,
+               const std::string& library_source)
+    {
+        std::error_code error;
+        std::string unique = base_name + "_" + std::to_string(getpid());
+        std::string source_file = (dir / (unique + ".cpp")).string();
+        std::string temp_library = (dir / (unique + ".so")).string();
+        std::string log = (dir / (unique + ".log")).string();
+        std::ofstream(source_file, std::ios::binary) << source;
+        std::string command = (compileCommand() +
+                               " -o " + shellQuote(temp_library) +
+                               " " + shellQuote(source_file) +
+                               " > " + shellQuote(log) + " 2>&1");
+        compilations_++;
+        bool ok = (std::system(command.c_str()) == 0);
+        if (ok)
+        {
+            std::filesystem::rename(temp_library, library, error);
+            if (!error)
+            {
+                std::filesystem::rename(source_file, library_source, error);
+            }
+            ok = !error;
+        }
+        if (!ok)
+        {
+            std::ifstream log_stream(log);
+            std::stringstream text;
+            text << log_stream.rdbuf();
+            error_message_ = "compile failed: " + command + "\n" + text.str();
+        }
+        std::filesystem::remove(source_file, error);
+        std::filesystem::remove(temp_library, error);
+        std::filesystem::remove(log, error);
+        return ok;
+    }
+    std::string prelude_;
+    std::string compile_command_ = "c++ -std=c++17 -O2 -shared -fPIC";
+    std::string cache_directory_;
+    std::string error_message_;
+    int compilations_ = 0;
+    int cache_hits_ = 0;
+    std::unordered_map<std::string, std::shared_ptr<const NativeProgram>>
+        programs_;
+    std::mutex mutex_;
+};
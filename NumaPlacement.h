@@ -0,0 +1,116 @@
+//
+//  NumaPlacement.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Placement of subpopulations ("islands") on the NUMA nodes of a machine with
+// several (for example a dual-socket server). See setNumaPlacement() in
+// Population.h.
+//
+// NumaTopology lists each node's CPUs, as read from Linux sysfs.
+// IslandPlacement gives each island a home node, and a worker thread pinned to
+// that node's CPUs. Work for an island (making its Individuals, evaluating
+// their trees) is run on its worker, so that memory is allocated from the home
+// node: Linux places a page on the node of the thread that first touches it,
+// and malloc() keeps per-thread arenas. No NUMA library is needed.
+
+#pragma once
+#include "ThreadPool.h"
+#include <fstream>
+
+class NumaTopology
+{
+public:
+    // Single node with all CPUs.
+    NumaTopology()
+    {
+        std::vector<int> all;
+        int count = std::max(1u, std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < count; cpu++) { all.push_back(cpu); }
+        node_cpus_.push_back(all);
+    }
+    // Given list of CPUs for each node.
+    NumaTopology(const std::vector<std::vector<int>>& node_cpus)
+      : node_cpus_(node_cpus)
+    {
+        assert(!node_cpus.empty());
+    }
+    // Topology of this machine, or a single node if it cannot be read.
+    static NumaTopology detect()
+    {
+        std::vector<std::vector<int>> nodes;
+        for (int node = 0; node < 1024; node++)
+        {
+            std::ifstream stream("/sys/devices/system/node/node" +
+                                 std::to_string(node) + "/cpulist");
+            std::string list;
+            if (stream && std::getline(stream, list))
+            {
+                std::vector<int> cpus = parseCpuList(list);
+                if (!cpus.empty()) { nodes.push_back(cpus); }
+            }
+        }
+        return nodes.empty() ? NumaTopology() : NumaTopology(nodes);
+    }
+    int nodeCount() const { return int(node_cpus_.size()); }
+    const std::vector<int>& cpus(int node) const { return node_cpus_.at(node); }
+    // Parse a Linux CPU list such as "0-3,8-11".
+    static std::vector<int> parseCpuList(const std::string& list)
+    {
+        std::vector<int> cpus;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ','))
+        {
+            int first = 0;
+            int last = 0;
+            int fields = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+            if (fields == 1) { last = first; }
+            if (fields >= 1)
+            {
+                for (int cpu = first; cpu <= last; cpu++)
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        return cpus;
+    }
+private:
+    std::vector<std::vector<int>> node_cpus_;
+};
+
+class IslandPlacement
+{
+public:
+    // Island i's home node is i modulo the number of nodes.
+    IslandPlacement(const NumaTopology& topology, int island_count)
+      : topology_(topology)
+    {
+        for (int i = 0; i < island_count; i++)
+        {
+            const std::vector<int>& cpus = topology.cpus(node(i));
+            auto pin = [cpus](int){ ThreadPool::pinCurrentThread(cpus); };
+            workers_.push_back(std::make_unique<ThreadPool>(1, pin));
+        }
+    }
+    int islandCount() const { return int(workers_.size()); }
+    int node(int island) const { return island % topology_.nodeCount(); }
+    const NumaTopology& topology() const { return topology_; }
+    // The single thread worker for an island, pinned to its home node.
+    ThreadPool& worker(int island) { return *workers_.at(island); }
+    // Run "function" on island's worker, returning when it is done.
+    void run(int island, const std::function<void()>& function)
+    {
+        if (worker(island).onWorkerThread()) { function(); return; }
+        ThreadPool::TaskGroup group(worker(island), false);
+        group.run(function);
+        group.wait();
+    }
+private:
+    NumaTopology topology_;
+    std::vector<std::unique_ptr<ThreadPool>> workers_;
+};
@@ -10,7 +10,13 @@
 #include "Individual.h"
 #include "FunctionSet.h"
 #include "TournamentGroup.h"
+#include "BloatControl.h"
+#include "Instrumentation.h"
+#include "FitnessCaseSampler.h"
+#include "Surrogate.h"
+#include "NumaPlacement.h"
 #include <iomanip>
+#include <numeric>
 
 class Population
 {
@@ -32,6 +38,17 @@ public:
                    0.5 * max_init_tree_size,
                    1.5 * max_init_tree_size,
                    &fs) {}
+    // As above, with a given BloatControl mode (and parameters).
+    Population(int individual_count,
+               int subpopulation_count,
+               int max_init_tree_size,
+               const FunctionSet& fs,
+               const BloatControl& bloat_control)
+      : Population(individual_count, subpopulation_count,
+                   max_init_tree_size, fs)
+    {
+        setBloatControl(bloat_control);
+    }
     Population(int individual_count,
                int subpopulation_count,
                int max_init_tree_size,
@@ -50,26 +67,79 @@ public:
                int min_crossover_tree_size,
                int max_crossover_tree_size,
                const FunctionSet* fs)
+      : Population(individual_count,
+                   subpopulation_count,
+                   max_init_tree_size,
+                   min_crossover_tree_size,
+                   max_crossover_tree_size,
+                   std::numeric_limits<float>::infinity(),
+                   fs) {}
+    // Constructor with "max_tree_cost" a budget for GpTree::cost() of each
+    // Individual's tree, both at initialization and after crossover.
+    Population(int individual_count,
+               int subpopulation_count,
+               int max_init_tree_size,
+               int min_crossover_tree_size,
+               int max_crossover_tree_size,
+               float max_tree_cost,
+               const FunctionSet& fs)
+      : Population(individual_count,
+                   subpopulation_count,
+                   max_init_tree_size,
+                   min_crossover_tree_size,
+                   max_crossover_tree_size,
+                   max_tree_cost,
+                   &fs) {}
+    Population(int individual_count,
+               int subpopulation_count,
+               int max_init_tree_size,
+               int min_crossover_tree_size,
+               int max_crossover_tree_size,
+               float max_tree_cost,
+               const FunctionSet* fs)
     {
         setFunctionSet(fs);
         setMaxInitTreeSize(max_init_tree_size);
         setMinCrossoverTreeSize(min_crossover_tree_size);
         setMaxCrossoverTreeSize(max_crossover_tree_size);
+        setMaxTreeCost(max_tree_cost);
         if (subpopulation_count == 0) { subpopulation_count = 1; } // Default.
         assert(subpopulation_count > 0);
         subpopulations_.resize(subpopulation_count);
+        auto make_individual = [&]()
+        {
+            return ((max_init_tree_size == 0) ?
+                    new Individual :
+                    new Individual(max_init_tree_size, max_tree_cost, *fs));
+        };
+        std::vector<Individual*> individuals(individual_count);
+        if (threadPool() && (max_init_tree_size > 0))
+        {
+            // Make random trees in parallel, each with its own LPRS() seeded
+            // (in order) from the global one, so same for any thread count.
+            std::vector<uint64_t> seeds(individual_count);
+            for (auto& seed : seeds) { seed = LPRS().nextInt(); }
+            threadPool()->parallelFor(0, individual_count, [&](int i)
+            {
+                LP::LocalRandomSequence random(seeds[i]);
+                individuals[i] = make_individual();
+            });
+        }
+        else
+        {
+            for (auto& individual : individuals)
+            {
+                individual = make_individual();
+            }
+        }
         for (int i = 0; i < individual_count; i++)
         {
-            Individual* new_individual = ((max_init_tree_size == 0) ?
-                                          new Individual :
-                                          new Individual(max_init_tree_size,
-                                                         *fs));
-            subpopulation(i % subpopulation_count).push_back(new_individual);
+            subpopulation(i % subpopulation_count).push_back(individuals[i]);
         }
         updateSortedCollectionOfIndividuals();
         idle_time_ = TimeDuration::zero();
         // TODO keep, remove, or move to unit tests?
-        assert(individual_count == sorted_collection_.size());
+        assert(individual_count == int(sorted_collection_.size()));
         assert(individual_count == getIndividualCount());
     }
     
@@ -85,6 +155,27 @@ public:
     // Functions that measure "absolute" fitness of an Individual in isolation.
     // (A shortcut for fitnesses that can be measured this way. Many cannot.)
     typedef std::function<float(Individual*)> FitnessFunction;
+    // Functions that measure fitness of an Individual on a given subset (a
+    // "mini-batch") of fitness cases, see FitnessCaseSampler.
+    typedef std::function<float(Individual*, const std::vector<int>&)>
+        BatchFitnessFunction;
+    // Functions that measure absolute fitness of many Individuals in one call,
+    // returning one fitness per Individual, so setup costs can be shared.
+    typedef std::function<std::vector<float>(const std::vector<Individual*>&)>
+        GroupFitnessFunction;
+    // Adapt a FitnessFunction to a GroupFitnessFunction.
+    static GroupFitnessFunction groupFitness(FitnessFunction fitness_function)
+    {
+        return [fitness_function](const std::vector<Individual*>& individuals)
+        {
+            std::vector<float> fitnesses;
+            for (auto i : individuals)
+            {
+                fitnesses.push_back(fitness_function(i));
+            }
+            return fitnesses;
+        };
+    }
 
     // Perform one step of the "steady state" evolutionary computation. Three
     // Individuals are selected randomly, from a random subpopulation. Holds a
@@ -96,13 +187,54 @@ public:
     {
         // Get current subpopulation, create a random TournamentGroup from it.
         SubPop& subpop = currentSubpopulation();
-        TournamentGroup random_group = randomTournamentGroup(subpop);
-        // Run tournament among the three, return ranked group.
-        TournamentGroup ranked_group = tournament_function(random_group);
+        TournamentGroup random_group;
+        {
+            auto timer = timePhase(Phase::TournamentSelection);
+            random_group = randomTournamentGroup(subpop);
+        }
+        evolutionStep(random_group, subpop, tournament_function);
+    }
+
+    // Perform one step, as above, for a TournamentGroup already selected from
+    // "subpop" (normally currentSubpopulation()). Used by Coevolution, which
+    // selects tournaments of several Populations before holding them.
+    void evolutionStep(TournamentGroup random_group,
+                       SubPop& subpop,
+                       TournamentFunction tournament_function)
+    {
+        // Run tournament among the three, return ranked group. (Unless, for
+        // Tarpeian bloat control, a large member is designated the loser.)
+        TournamentGroup ranked_group = random_group;
+        bool tarpeian = ((bloat_control_.mode() == BloatControl::Tarpeian) &&
+                         bloat_control_.tarpeian(ranked_group,
+                                                 cachedAverageTreeSize()));
+        // An Individual already known to be over the EvalBudget loses.
+        if (!tarpeian && !overBudgetLoses(ranked_group))
+        {
+            auto timer = timePhase(Phase::TournamentFunction);
+            tournament_over_budget_ = false;
+            if (withinEvalBudget([&]()
+                { ranked_group = tournament_function(random_group); }))
+            {
+                bloat_control_.parsimony(ranked_group);
+                overBudgetLoses(ranked_group);
+            }
+            else
+            {
+                // Stopped, but not by a known Individual: cancel tournament.
+                ranked_group.setValid(false);
+            }
+            if (tournament_over_budget_ &&
+                (eval_budget_.policy() == EvalBudget::InvalidTournament))
+            {
+                ranked_group.setValid(false);
+            }
+        }
         // Complete the step based on this ranked group, if it is valid.
         if (ranked_group.getValid()) { evolutionStep(ranked_group, subpop); }
         // Increment step count (before logger() call for 1 based step numbers).
         incrementStepCount();
+        auto timer = timePhase(Phase::Logging);
         logger();
     }
 
@@ -114,7 +246,7 @@ public:
     // between subpopulations and maintain sorted index of Individuals.
     void evolutionStep(TournamentGroup ranked_group, SubPop& subpop)
     {
-        Individual* loser = ranked_group.worstIndividual();
+        [[maybe_unused]] Individual* loser = ranked_group.worstIndividual();
         int loser_index = ranked_group.worstIndex();
         assert(loser);
         // Other two become parents of new offspring.
@@ -123,23 +255,37 @@ public:
         // Both parent's rank increases because they survived the tournament.
         parent0->incrementTournamentsSurvived();
         parent1->incrementTournamentsSurvived();
-        // Create new offspring tree by crossing-over these two parents.
-        GpTree new_tree;
-        GpTree::crossover(parent0->tree(),
-                          parent1->tree(),
-                          new_tree,
-                          getMinCrossoverTreeSize(),
-                          getMaxCrossoverTreeSize(),
-                          getFunctionSet()->getCrossoverMinSize());
-        // Mutate constants in new tree.
-        new_tree.mutate();
-        // Create new offspring Individual from new tree.
-        Individual* offspring = new Individual(new_tree);
-        // Construct and cache the result of evaluating new offspring's GpTree.
-        offspring->treeValue();
+        float parent_fitness = parentFitness(*parent0, *parent1);
+        // Create new offspring tree by crossing-over these two parents, then
+        // mutate constants in new tree. (Maybe best of several candidates.)
+        // Create new offspring Individual from new tree, and construct and
+        // cache the result of evaluating its GpTree. (All on island's home
+        // node under NUMA placement.)
+        Individual* offspring = nullptr;
+        onIsland(subpop, [&]()
+        {
+            GpTree new_tree;
+            float static_quality = makeOffspringTree(*parent0, *parent1,
+                                                     parent_fitness, new_tree);
+            offspring = new Individual(new_tree);
+            offspring->setParentFitness(parent_fitness);
+            if (static_quality_)
+            {
+                offspring->setStaticQualityMetric(static_quality);
+            }
+            auto timer = timePhase(Phase::TreeEvaluation);
+            if (!withinEvalBudget([&](){ offspring->treeValue(); }))
+            {
+                markOverBudget(offspring);
+            }
+        });
         // Delete tournament loser from Population, replace with new offspring.
-        replaceIndividual(loser_index, offspring, subpop);
+        {
+            auto timer = timePhase(Phase::Replacement);
+            replaceIndividual(loser_index, offspring, subpop);
+        }
         // Occasionally migrate Individuals between subpopulations.
+        auto timer = timePhase(Phase::Migration);
         subpopulationMigration();
     }
 
@@ -159,9 +305,21 @@ public:
                 // The existing sort index, if any, is now invalid.
                 sort_cache_invalid_ = true;
                 // Tree value should be previously cached, but just to be sure.
-                individual->treeValue();
-                // Cache fitness on Individual using given FitnessFunction.
-                individual->setFitness(fitness_function(individual));
+                // Then cache fitness on Individual using given FitnessFunction.
+                float fitness = 0;
+                if (withinEvalBudget([&]()
+                    {
+                        individual->treeValue();
+                        fitness = fitness_function(individual);
+                    }))
+                {
+                    individual->setFitness(fitness);
+                    trainSurrogate(*individual, fitness);
+                }
+                else
+                {
+                    markOverBudget(individual);
+                }
             }
             return individual->getFitness();
         };
@@ -174,10 +332,262 @@ public:
         // Finally, do a tournament-based evolution step.
         evolutionStep(tournament_function);
     }
+
+    // Perform one step using a GroupFitnessFunction. Tournament members without
+    // a cached fitness are measured in one call.
+    void evolutionStep(GroupFitnessFunction group_fitness_function)
+    {
+        auto tournament_function = [&](TournamentGroup group)
+        {
+            std::vector<Individual*> individuals;
+            for (auto& member : group.members())
+            {
+                Individual* individual = member.individual;
+                if (!individual->hasFitness() && !individual->overBudget())
+                {
+                    individuals.push_back(individual);
+                }
+            }
+            if (!individuals.empty() &&
+                !setGroupFitness(individuals, group_fitness_function))
+            {
+                // Stopped by EvalBudget, not attributable to one Individual.
+                group.setValid(false);
+            }
+            group.setAllMetrics([](Individual* individual)
+                                { return individual->getFitness(); });
+            return group;
+        };
+        evolutionStep(tournament_function);
+    }
+    // Measure fitness of all Individuals without a cached fitness, in calls of
+    // at most "max_batch" Individuals (zero means all in one call). Returns
+    // the number which lacked fitness. For example to prime a new Population.
+    int evaluateAllUnevaluated(GroupFitnessFunction group_fitness_function,
+                               int max_batch = 0)
+    {
+        std::vector<Individual*> unevaluated;
+        applyToAllIndividuals([&](Individual* individual)
+        {
+            if (!individual->hasFitness()) unevaluated.push_back(individual);
+        });
+        size_t batch = (max_batch > 0) ? max_batch : unevaluated.size();
+        std::vector<std::vector<Individual*>> batches;
+        for (size_t i = 0; i < unevaluated.size(); i += batch)
+        {
+            auto begin = unevaluated.begin() + i;
+            auto end = unevaluated.begin() + std::min(i + batch,
+                                                      unevaluated.size());
+            batches.push_back({begin, end});
+        }
+        // Batches are measured in parallel if threadPool() is set (so
+        // group_fitness_function must be thread safe), then cached in order.
+        std::vector<GroupMeasurement> measurements(batches.size());
+        auto measure = [&](int b)
+        {
+            measurements[b] = measureGroupFitness(batches[b],
+                                                  group_fitness_function);
+        };
+        if (threadPool())
+        {
+            threadPool()->parallelFor(0, int(batches.size()), measure);
+        }
+        else
+        {
+            for (int b = 0; b < int(batches.size()); b++) { measure(b); }
+        }
+        for (auto& measurement : measurements) { cacheFitness(measurement); }
+        return int(unevaluated.size());
+    }
+
+    // Perform one step using "mini-batch" fitness. Draws a new batch of cases
+    // from fitnessCaseSampler(), on which each member of the tournament is
+    // judged. Its result updates the Individual's fitness estimate, which is
+    // used as its tournament metric.
+    void evolutionStep(BatchFitnessFunction batch_fitness_function)
+    {
+        assert(fitness_case_sampler_.caseCount() > 0);
+        const std::vector<int>& batch = fitness_case_sampler_.nextBatch();
+        int window = fitness_case_sampler_.estimateWindow();
+        auto batch_fitness = [&](Individual* individual)
+        {
+            sort_cache_invalid_ = true;
+            float fitness = 0;
+            if (withinEvalBudget([&]()
+                {
+                    individual->treeValue();
+                    fitness = batch_fitness_function(individual, batch);
+                }))
+            {
+                individual->updateFitnessEstimate(fitness, window,
+                                                  getStepCount());
+                trainSurrogate(*individual, fitness);
+            }
+            else
+            {
+                markOverBudget(individual);
+            }
+            return individual->getFitness();
+        };
+        auto tournament_function = [&](TournamentGroup group)
+        {
+            group.setAllMetrics(batch_fitness);
+            return group;
+        };
+        evolutionStep(tournament_function);
+    }
+    // Optional surrogate fitness model, see Surrogate.h. When it has at least
+    // "min_training" samples, each step makes "candidates" offspring and keeps
+    // the one with best predicted fitness.
+    void setSurrogate(std::shared_ptr<SurrogateModel> surrogate,
+                      int candidates = 4,
+                      int min_training = 50)
+    {
+        surrogate_ = surrogate;
+        surrogate_candidates_ = candidates;
+        surrogate_min_training_ = min_training;
+    }
+    std::shared_ptr<SurrogateModel> surrogate() const { return surrogate_; }
+    // Optional static quality metric: a cheap function (bigger is better) used
+    // to reject obviously poor offspring before they are evaluated. Each step
+    // makes "candidates" offspring, scores them (in parallel threads unless
+    // "parallel" is false, so the function must be thread safe), and keeps the
+    // best. It is cached on the offspring, see setStaticQualityMetric().
+    typedef std::function<float(const GpTree&)> StaticQualityFunction;
+    void setStaticQuality(StaticQualityFunction static_quality,
+                          int candidates = 4,
+                          bool parallel = true)
+    {
+        static_quality_ = static_quality;
+        static_quality_candidates_ = candidates;
+        static_quality_parallel_ = parallel;
+    }
+    // Source of mini-batches for evolutionStep(BatchFitnessFunction).
+    const FitnessCaseSampler& fitnessCaseSampler() const
+        { return fitness_case_sampler_; }
+    void setFitnessCaseSampler(const FitnessCaseSampler& sampler)
+        { fitness_case_sampler_ = sampler; }
+    // Clear cached mini-batch fitness estimates last updated more than
+    // "max_age" steps ago, so they will be measured again. Returns count.
+    int refreshStaleFitness(int max_age)
+    {
+        int count = 0;
+        applyToAllIndividuals([&](Individual* individual)
+        {
+            if (individual->hasFitness() && individual->fitnessSamples() &&
+                (getStepCount() - individual->fitnessStep() > max_age))
+            {
+                individual->clearFitness();
+                count++;
+            }
+        });
+        if (count) { sort_cache_invalid_ = true; }
+        return count;
+    }
     
+    // Make offspring tree by crossover and mutation. With a static quality
+    // function, or a trained surrogate model, make several candidates and keep
+    // the best: the one with highest static quality, ties broken by predicted
+    // fitness. Returns the static quality of the tree kept (or zero).
+    float makeOffspringTree(const Individual& parent0,
+                            const Individual& parent1,
+                            float parent_fitness,
+                            GpTree& offspring)
+    {
+        int candidates = std::max(static_quality_ ?
+                                  static_quality_candidates_ : 1,
+                                  surrogateReady() ? surrogate_candidates_ : 1);
+        std::vector<GpTree> trees(candidates);
+        for (auto& tree : trees)
+        {
+            {
+                auto timer = timePhase(Phase::Crossover);
+                crossoverWithBloatControl(parent0, parent1, tree);
+            }
+            {
+                auto timer = timePhase(Phase::Mutation);
+                tree.mutate();
+            }
+        }
+        std::vector<float> quality(candidates, 0);
+        std::vector<float> prediction(candidates, 0);
+        if ((candidates > 1) && static_quality_)
+        {
+            // Score candidates with static quality metric, maybe in parallel.
+            auto score = [&](int i) { quality[i] = static_quality_(trees[i]); };
+            if (static_quality_parallel_)
+            {
+                ThreadPool& pool = (threadPool() ? *threadPool() :
+                                    ThreadPool::shared());
+                pool.parallelFor(0, candidates, score);
+            }
+            else
+            {
+                for (int i = 0; i < candidates; i++) { score(i); }
+            }
+        }
+        else if (static_quality_)
+        {
+            quality[0] = static_quality_(trees[0]);
+        }
+        if ((candidates > 1) && surrogateReady())
+        {
+            for (int i = 0; i < candidates; i++)
+            {
+                prediction[i] = surrogate_->predict(trees[i], parent_fitness);
+            }
+        }
+        int best = 0;
+        for (int i = 1; i < candidates; i++)
+        {
+            if ((quality[i] > quality[best]) ||
+                ((quality[i] == quality[best]) &&
+                 (prediction[i] > prediction[best]))) { best = i; }
+        }
+        offspring = std::move(trees[best]);
+        return quality[best];
+    }
+
+    // Create offspring tree by crossover of two parents' trees. Repeats when
+    // rejected by bloat control (if any) up to its maxRetries().
+    void crossoverWithBloatControl(const Individual& parent0,
+                                   const Individual& parent1,
+                                   GpTree& offspring)
+    {
+        if (bloat_control_.needsHistogram(getIndividualCount()))
+        {
+            std::vector<int> sizes;
+            applyToAllIndividuals([&](Individual* i)
+                                  { sizes.push_back(i->tree().size()); });
+            bloat_control_.setHistogram(sizes);
+        }
+        for (int retries = 0; true; retries++)
+        {
+            GpTree::crossover(parent0.tree(),
+                              parent1.tree(),
+                              offspring,
+                              getMinCrossoverTreeSize(),
+                              getMaxCrossoverTreeSize(),
+                              getFunctionSet()->getCrossoverMinSize(),
+                              getMaxTreeCost());
+            if (bloat_control_.acceptOffspring(offspring,
+                                               getMaxCrossoverTreeSize()))
+            {
+                break;
+            }
+            if (retries >= bloat_control_.maxRetries())
+            {
+                bloat_control_.fallback(offspring, parent1.tree());
+                break;
+            }
+        }
+    }
+
     // Delete Individual at index i, then overwrite pointer with replacement.
     void replaceIndividual(int i, Individual* new_individual, SubPop& subpop)
     {
+        bloat_control_.replaceInHistogram(subpop.at(i)->tree().size(),
+                                          new_individual->tree().size());
         delete subpop.at(i);
         subpop.at(i) = new_individual;
         sort_cache_invalid_ = true;
@@ -197,7 +607,7 @@ public:
     {
         assert(subpop.size() >= 3);
         std::vector<int> i;  // Vec to hold the three unique indices.
-        int max_tries = 1000;
+        [[maybe_unused]] int max_tries = 1000;
         auto add_unique_index = [&]()
         {
             int index = randomIndividualIndex(subpop);
@@ -246,6 +656,7 @@ public:
     {
         if (sort_cache_invalid_)
         {
+            auto timer = timePhase(Phase::Sort);
             // Collect pointers to all Individuals into sorted_collection_.
             sorted_collection_.clear();
             applyToAllIndividuals([&]
@@ -260,6 +671,10 @@ public:
         sort_cache_invalid_ = false;
     }
     
+    // Force the sorted index to be rebuilt on next use. (For example after
+    // modifying the fitness of Individuals other than via evolutionStep().)
+    void invalidateSortedCollection() { sort_cache_invalid_ = true; }
+
     // Return pointer to Individual with best fitness.
     Individual* bestFitness()
     {
@@ -276,18 +691,28 @@ public:
     // Average of "tree size" over all Individuals.
     int averageTreeSize() const
     {
-        int total = 0;
-        auto f = [&](Individual* i){ total += i->tree().size(); };
-        applyToAllIndividuals(f);
-        return total / getIndividualCount();
+        double total = sumOverIndividuals([](Individual* i)
+                                          { return i->tree().size(); });
+        return int(total) / getIndividualCount();
     }
     
+    // Average tree size, recomputed only every 10 steps, for bloat control.
+    float cachedAverageTreeSize()
+    {
+        if ((average_tree_size_step_ < 0) ||
+            (getStepCount() - average_tree_size_step_ >= 10))
+        {
+            average_tree_size_ = averageTreeSize();
+            average_tree_size_step_ = getStepCount();
+        }
+        return average_tree_size_;
+    }
+
     // Average of "tournaments survived" (or abs fitness) over all Individuals.
     float averageFitness() const
     {
-        float total = 0;
-        auto f = [&](Individual* i){ total += i->getFitness(); };
-        applyToAllIndividuals(f);
+        double total = sumOverIndividuals([](Individual* i)
+                                          { return i->getFitness(); });
         return total / getIndividualCount();
     }
     
@@ -312,6 +737,12 @@ public:
             // Swap them.
             subpop1.at(individual_index_1) = individual_2;
             subpop2.at(individual_index_2) = individual_1;
+            // Under NUMA placement, move each to its new island's node.
+            if (numaPlacement())
+            {
+                rehome(subpop_index_1, individual_index_1);
+                rehome(subpop_index_2, individual_index_2);
+            }
         }
     }
 
@@ -357,6 +788,10 @@ public:
             if (f <= 100) { std::cout << f; } else { std::cout << int(f); }
         }
         std::cout << ")" << std::setprecision(default_precision);
+        if (p.bloatControl().mode() != BloatControl::None)
+        {
+            std::cout << ", " << p.bloatControl().statsString();
+        }
         std::cout << std::endl;
     }
 
@@ -372,6 +807,7 @@ public:
     // Return (writable/non-const) reference to i-th subpopulation.
     // Maybe this should be private, perhaps with a const public version?
     SubPop& subpopulation(int s) { return subpopulations_.at(s); }
+    const SubPop& subpopulation(int s) const { return subpopulations_.at(s); }
     
     // Returns total number of Individuals contained in this Population
     int getIndividualCount() const
@@ -390,6 +826,7 @@ public:
     // Returns number of evolution steps already taken in this Population.
     int getStepCount() const { return step_count_; }
     void incrementStepCount() { step_count_++; }
+    void setStepCount(int count) { step_count_ = count; }
     // The probability, on any given evolutionStep(), that migration will occur.
     float getMigrationLikelihood() const { return migration_likelihood_; }
     void setMigrationLikelihood(float ml) { migration_likelihood_ = ml; }
@@ -403,10 +840,129 @@ public:
     void setMinCrossoverTreeSize(int size) { min_crossover_tree_size_ = size; }
     int getMaxCrossoverTreeSize() const { return max_crossover_tree_size_; }
     void setMaxCrossoverTreeSize(int size) { max_crossover_tree_size_ = size; }
+
+    // Get/set bloat control mode and parameters, see BloatControl.h.
+    BloatControl& bloatControl() { return bloat_control_; }
+    const BloatControl& bloatControl() const { return bloat_control_; }
+    void setBloatControl(const BloatControl& bc) { bloat_control_ = bc; }
+
+    // Get/set budget for GpTree::cost() of new trees (default is unlimited).
+    float getMaxTreeCost() const { return max_tree_cost_; }
+    void setMaxTreeCost(float cost) { max_tree_cost_ = cost; }
     
+    // Limits on each evaluation: of an offspring's tree, of a FitnessFunction,
+    // of a TournamentFunction. Default is unlimited. See EvalBudget.h. Under
+    // policy WorstFitness, an Individual whose evaluation is stopped is marked
+    // overBudget() and loses every tournament it is in. Under policy
+    // InvalidTournament, a tournament during which any evaluation is stopped
+    // is canceled. A stopped TournamentFunction always cancels the tournament.
+    // evalBudget().cancel() stops evaluations in progress (from any thread).
+    const EvalBudget& evalBudget() const { return eval_budget_; }
+    void setEvalBudget(const EvalBudget& budget) { eval_budget_ = budget; }
+    // Number of evaluations stopped by evalBudget().
+    int getOverBudgetCount() const { return over_budget_count_; }
+    // Run an evaluation within evalBudget() (if limited), returns false if it
+    // was stopped. Limits are multiplied by "scale" for an evaluation of a
+    // group. Thread safe, since it does not count stops: for an evaluation of
+    // one Individual, call recordOverBudget() (not thread safe) afterward.
+    bool runWithinEvalBudget(const std::function<void()>& evaluation,
+                             int scale = 1) const
+    {
+        if (!eval_budget_.limited()) { evaluation(); return true; }
+        EvalBudget budget = eval_budget_;
+        budget.setMaxNodes(budget.maxNodes() * scale);
+        budget.setMaxSeconds(budget.maxSeconds() * scale);
+        return budget.run(evaluation);
+    }
+    // Count a stopped evaluation of "individual", and under policy
+    // WorstFitness mark it overBudget().
+    void recordOverBudget(Individual* individual)
+    {
+        countOverBudget();
+        markOverBudget(individual);
+    }
+
+    // ThreadPool for parallel operations: initialization of Individuals (if
+    // set as defaultThreadPool() before construction), statistics,
+    // evaluateAllUnevaluated(), and scoring static quality candidates. If
+    // none (the default) these are sequential, except static quality scoring
+    // uses ThreadPool::shared().
+    ThreadPool* threadPool() const { return thread_pool_; }
+    void setThreadPool(ThreadPool* pool) { thread_pool_ = pool; }
+    static ThreadPool* defaultThreadPool() { return default_thread_pool_; }
+    static void setDefaultThreadPool(ThreadPool* pool)
+    {
+        default_thread_pool_ = pool;
+    }
+
+    // NUMA placement of subpopulations, see NumaPlacement.h. When enabled,
+    // each subpopulation gets a home node (by default from
+    // NumaTopology::detect()) and a worker thread pinned to it. Its
+    // Individuals are moved there, and from then on its offspring are made
+    // and evaluated there, as are migrants on arrival. (A moved Individual
+    // with a cached fitness is not evaluated again until its tree value is
+    // needed.) This only changes where memory lives: steps still run one at
+    // a time, the caller waiting while the island's worker does its part.
+    // GpFunctions must tolerate running on a thread other than the caller's.
+    // Returns true if enabled, which is never for a single node topology.
+    bool setNumaPlacement(const NumaTopology& topology = NumaTopology::detect())
+    {
+        placement_ = nullptr;
+        if (topology.nodeCount() > 1)
+        {
+            placement_ = std::make_unique<IslandPlacement>
+                (topology, getSubpopulationCount());
+            for (int s = 0; s < getSubpopulationCount(); s++)
+            {
+                for (int i = 0; i < int(subpopulation(s).size()); i++)
+                {
+                    rehome(s, i);
+                }
+            }
+        }
+        return numaPlacement();
+    }
+    void clearNumaPlacement() { placement_ = nullptr; }
+    // Replace a random Individual of the s-th subpopulation with a migrant
+    // made from "tree" (say received from another process). Under NUMA
+    // placement it is made on that island, and evaluated there unless it
+    // comes with a fitness. Returns the migrant.
+    Individual* insertMigrant(int s,
+                              const GpTree& tree,
+                              bool has_fitness,
+                              float fitness)
+    {
+        SubPop& subpop = subpopulation(s);
+        Individual* migrant = nullptr;
+        onIsland(subpop, [&]()
+        {
+            migrant = new Individual(tree);
+            if (has_fitness) { migrant->setFitness(fitness); }
+            else if (placement_ &&
+                     !withinEvalBudget([&](){ migrant->treeValue(); }))
+            {
+                markOverBudget(migrant);
+            }
+        });
+        replaceIndividual(LPRS().randomN(subpop.size()), migrant, subpop);
+        return migrant;
+    }
+    bool numaPlacement() const { return bool(placement_); }
+    // Home node of a subpopulation under NUMA placement, or 0.
+    int numaNode(int subpopulation_index) const
+    {
+        return placement_ ? placement_->node(subpopulation_index) : 0;
+    }
+
     // Duration of idle time during step that should be ignored for logging.
     void setIdleTime(TimeDuration duration) { idle_time_ = duration; }
 
+    // Per-phase timing of evolutionStep(). Disabled by default, enable with:
+    // instrumentation().setEnabled(true). See Instrumentation.h for how to
+    // get snapshots of the stats, reset them, or write CSV or trace files.
+    Instrumentation& instrumentation() { return instrumentation_; }
+    const Instrumentation& instrumentation() const { return instrumentation_; }
+
 private:
     std::function<void(Population&)> logger_function_ = basicLogger;
     std::chrono::time_point<std::chrono::high_resolution_clock> start_time_;
@@ -419,6 +975,11 @@ private:
     bool sort_cache_invalid_ = true;
     // Const pointer to this Population's FunctionSet.
     const FunctionSet* function_set_ = nullptr;
+    // Pool for parallel operations, if any.
+    ThreadPool* thread_pool_ = default_thread_pool_;
+    // NUMA placement of subpopulations, if enabled.
+    std::unique_ptr<IslandPlacement> placement_;
+    static inline ThreadPool* default_thread_pool_ = nullptr;
     // The probability, on any given evolutionStep(), that migration will occur.
     float migration_likelihood_ = 0.05;
     // Max size for initial random trees.
@@ -426,8 +987,218 @@ private:
     // Min/max crossover tree size.
     int min_crossover_tree_size_ = 0;
     int max_crossover_tree_size_ = std::numeric_limits<int>::max();
+    // Budget for GpTree::cost() of new trees.
+    float max_tree_cost_ = std::numeric_limits<float>::infinity();
+    // Bloat control mode, parameters, and stats.
+    BloatControl bloat_control_;
+    // Source of mini-batches for evolutionStep(BatchFitnessFunction).
+    FitnessCaseSampler fitness_case_sampler_;
+    // Optional static quality metric for best-of-N offspring, its parameters.
+    StaticQualityFunction static_quality_ = nullptr;
+    int static_quality_candidates_ = 4;
+    bool static_quality_parallel_ = true;
+    // Optional surrogate fitness model, and its parameters.
+    std::shared_ptr<SurrogateModel> surrogate_;
+    int surrogate_candidates_ = 4;
+    int surrogate_min_training_ = 50;
+    bool surrogateReady() const
+    {
+        return (surrogate_ &&
+                surrogate_->trainingSamples() >= surrogate_min_training_);
+    }
+    void trainSurrogate(const Individual& individual, float fitness)
+    {
+        if (surrogate_)
+        {
+            surrogate_->train(individual.tree(),
+                              individual.getParentFitness(),
+                              fitness);
+        }
+    }
+    // Measure and cache fitness of Individuals with a GroupFitnessFunction.
+    // Each tree value is computed within evalBudget(), then the group call is
+    // made within that budget scaled by group size. Returns false if the group
+    // call was stopped.
+    bool setGroupFitness(const std::vector<Individual*>& individuals,
+                         GroupFitnessFunction group_fitness_function)
+    {
+        GroupMeasurement measurement =
+            measureGroupFitness(individuals, group_fitness_function);
+        cacheFitness(measurement);
+        return measurement.completed;
+    }
+    // Results of measureGroupFitness().
+    struct GroupMeasurement
+    {
+        std::vector<Individual*> measurable;
+        std::vector<Individual*> over_budget;
+        std::vector<float> fitnesses;
+        bool completed = true;
+    };
+    // First half of setGroupFitness(): changes only the given Individuals, so
+    // can run on a ThreadPool worker.
+    GroupMeasurement measureGroupFitness(const std::vector<Individual*>&
+                                         individuals,
+                                         GroupFitnessFunction
+                                         group_fitness_function) const
+    {
+        GroupMeasurement result;
+        for (auto individual : individuals)
+        {
+            bool ok = runWithinEvalBudget([&](){ individual->treeValue(); });
+            (ok ? result.measurable : result.over_budget).push_back(individual);
+        }
+        if (!result.measurable.empty())
+        {
+            auto& measurable = result.measurable;
+            result.completed = runWithinEvalBudget([&]()
+                { result.fitnesses = group_fitness_function(measurable); },
+                int(measurable.size()));
+        }
+        return result;
+    }
+    // Second half of setGroupFitness(): cache fitnesses, or record stops.
+    void cacheFitness(const GroupMeasurement& measurement)
+    {
+        for (auto individual : measurement.over_budget)
+        {
+            countOverBudget();
+            markOverBudget(individual);
+        }
+        if (!measurement.completed)
+        {
+            countOverBudget();
+        }
+        else if (!measurement.measurable.empty())
+        {
+            const auto& measurable = measurement.measurable;
+            const auto& fitnesses = measurement.fitnesses;
+            assert(fitnesses.size() == measurable.size());
+            for (int i = 0; i < int(measurable.size()); i++)
+            {
+                measurable[i]->setFitness(fitnesses[i]);
+                trainSurrogate(*measurable[i], fitnesses[i]);
+            }
+            sort_cache_invalid_ = true;
+        }
+    }
+    // Average fitness of parents, NaN if either has no (absolute) fitness.
+    static float parentFitness(const Individual& parent0,
+                               const Individual& parent1)
+    {
+        return ((parent0.hasFitness() && parent1.hasFitness()) ?
+                (parent0.getFitness() + parent1.getFitness()) / 2 :
+                std::numeric_limits<float>::quiet_NaN());
+    }
+    // Limits on evaluation, and count of evaluations stopped by them.
+    EvalBudget eval_budget_;
+    int over_budget_count_ = 0;
+    bool tournament_over_budget_ = false;
+    // Run evaluation within eval_budget_ (if limited), false if it was stopped.
+    // Limits are multiplied by "scale" for an evaluation of a group.
+    bool withinEvalBudget(const std::function<void()>& evaluation,
+                          int scale = 1)
+    {
+        bool completed = runWithinEvalBudget(evaluation, scale);
+        if (!completed) { countOverBudget(); }
+        return completed;
+    }
+    void countOverBudget()
+    {
+        over_budget_count_++;
+        tournament_over_budget_ = true;
+    }
+    // Under policy WorstFitness, mark Individual whose evaluation was stopped.
+    void markOverBudget(Individual* individual)
+    {
+        if (eval_budget_.policy() == EvalBudget::WorstFitness)
+        {
+            individual->setOverBudget(true);
+            individual->setFitness(std::numeric_limits<float>::lowest());
+            sort_cache_invalid_ = true;
+        }
+    }
+    // If a member of group is overBudget(), designate it the loser. Returns
+    // true if so.
+    bool overBudgetLoses(TournamentGroup& group)
+    {
+        for (auto& member : group.members())
+        {
+            if (member.individual->overBudget())
+            {
+                group.designateWorstIndividual(member.individual);
+                return true;
+            }
+        }
+        return false;
+    }
+    // Sum of "function" over all Individuals, in parallel on threadPool() if
+    // any. (Partial sums are added in a fixed order, so result is repeatable.)
+    double sumOverIndividuals(const std::function<double(Individual*)>&
+                              function) const
+    {
+        if (!threadPool())
+        {
+            double total = 0;
+            applyToAllIndividuals([&](Individual* i){ total += function(i); });
+            return total;
+        }
+        std::vector<Individual*> all;
+        applyToAllIndividuals([&](Individual* i){ all.push_back(i); });
+        int chunk = 256;
+        int chunks = (int(all.size()) + chunk - 1) / chunk;
+        std::vector<double> sums(chunks, 0);
+        threadPool()->parallelFor(0, chunks, [&](int c)
+        {
+            int end = std::min(int(all.size()), (c + 1) * chunk);
+            for (int i = c * chunk; i < end; i++)
+            {
+                sums[c] += function(all[i]);
+            }
+        });
+        return std::accumulate(sums.begin(), sums.end(), 0.0);
+    }
+    // Run "function" on the worker for subpop's island, or (without NUMA
+    // placement) directly.
+    void onIsland(const SubPop& subpop, const std::function<void()>& function)
+    {
+        if (!placement_) { function(); return; }
+        int s = int(&subpop - subpopulations_.data());
+        assert((s >= 0) && (s < getSubpopulationCount()));
+        placement_->run(s, function);
+    }
+    // Replace i-th Individual of s-th SubPop with a copy made on that
+    // subpopulation's island. The copy is evaluated there too, unless it has
+    // a cached fitness (so its tree value may never be needed).
+    void rehome(int s, int i)
+    {
+        SubPop& subpop = subpopulation(s);
+        Individual* original = subpop.at(i);
+        onIsland(subpop, [&]()
+        {
+            Individual* copy = original->relocatedCopy();
+            if (!copy->hasFitness() &&
+                !withinEvalBudget([&](){ copy->treeValue(); }))
+            {
+                markOverBudget(copy);
+            }
+            subpop.at(i) = copy;
+        });
+        delete original;
+        sort_cache_invalid_ = true;
+    }
+    // Cache for cachedAverageTreeSize().
+    float average_tree_size_ = 0;
+    int average_tree_size_step_ = -1;
     // Duration of idle time during step that should be ignored for logging.
     TimeDuration idle_time_;
+    // Per-phase timing of evolutionStep().
+    Instrumentation instrumentation_;
+    typedef Instrumentation::Phase Phase;
+    Instrumentation::Scope timePhase(Phase phase)
+    {
+        return Instrumentation::Scope(instrumentation_, phase);
+    }
 };
 
 // TODO had been in main.cpp, now here.
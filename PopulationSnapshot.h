@@ -0,0 +1,466 @@
+//
+//  PopulationSnapshot.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// A PopulationSnapshot is a single binary file recording the state of every
+// Individual in a Population: its GpTree, fitness, and position within its
+// subpopulation. The file is designed to be mmap()-ed read-only and used in
+// place: trees are stored "flat" as preorder arrays of fixed size nodes, and
+// GpType/GpFunction references are small integer IDs into tables of names in
+// the file header. So analysis tools can inspect hundreds of snapshots from a
+// run without deserializing each Individual. A snapshot can also be resolved
+// against a FunctionSet to rebuild GpTrees, or a whole Population to restart.
+//
+// File layout (native byte order, every section 8-byte aligned):
+//     Header
+//     TypeEntry[type_count]              (names of GpTypes)
+//     FunctionEntry[function_count]      (names, return types, arities)
+//     IndividualEntry[individual_count]  (per-Individual data, node range)
+//     FlatNode[node_count]               (all trees, each in preorder)
+//     char[string_bytes]                 (names and leaf value text)
+
+#pragma once
+#include "Population.h"
+#include "MappedFile.h"
+#include <fstream>
+#include <memory>
+#include <string_view>
+
+class PopulationSnapshot
+{
+public:
+    // Fixed size records stored in snapshot file.
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t step_count;
+        uint32_t subpopulation_count;
+        uint32_t individual_count;
+        uint32_t type_count;
+        uint32_t function_count;
+        uint64_t node_count;
+        uint64_t string_bytes;
+        uint64_t types_offset;
+        uint64_t functions_offset;
+        uint64_t individuals_offset;
+        uint64_t nodes_offset;
+        uint64_t strings_offset;
+        int32_t max_init_tree_size;
+        int32_t min_crossover_tree_size;
+        int32_t max_crossover_tree_size;
+        float migration_likelihood;
+    };
+    struct TypeEntry
+    {
+        uint64_t name_offset;
+        uint32_t name_size;
+        uint32_t padding;
+    };
+    struct FunctionEntry
+    {
+        uint64_t name_offset;
+        uint32_t name_size;
+        uint32_t return_type;
+        uint32_t arity;
+        uint32_t padding;
+    };
+    struct IndividualEntry
+    {
+        uint64_t first_node;
+        uint32_t node_count;
+        uint32_t subpopulation;
+        uint32_t index_in_subpopulation;
+        int32_t tournaments_survived;
+        float fitness;
+        uint32_t has_fitness;
+        int32_t standing;
+        uint32_t padding;
+    };
+    // One node of a flattened GpTree. A leaf has function == -1, its value is
+    // stored as text (from GpType::identityString(), so floating point values
+    // are exact) in the string section. Other
+    // nodes are followed (in preorder) by the subtree for each parameter.
+    struct FlatNode
+    {
+        uint64_t leaf_offset;
+        uint32_t leaf_size;
+        int32_t function;
+        uint32_t type;
+        uint32_t padding;
+        bool isLeaf() const { return function < 0; }
+    };
+
+    // Write a snapshot of Population "population" to file "pathname". Returns
+    // false if the file could not be written.
+    static bool write(const Population& population, const std::string& pathname)
+    {
+        // GpTypes and GpFunctions are identified by their FunctionSet IDs.
+        const FunctionSet& fs = *population.getFunctionSet();
+        std::string strings;
+        auto add_string = [&](const std::string& s)
+        {
+            uint64_t offset = strings.size();
+            strings += s;
+            return offset;
+        };
+        std::vector<TypeEntry> types;
+        for (auto& gp_type : fs.gpTypes())
+        {
+            const std::string& name = gp_type.name();
+            types.push_back({add_string(name), uint32_t(name.size()), 0});
+        }
+        std::vector<FunctionEntry> functions;
+        for (auto& gp_function : fs.gpFunctions())
+        {
+            const std::string& name = gp_function.name();
+            functions.push_back({add_string(name),
+                                 uint32_t(name.size()),
+                                 uint32_t(gp_function.returnType()->id()),
+                                 uint32_t(gp_function.parameterTypes().size()),
+                                 0});
+        }
+        // Flatten each Individual's tree into preorder sequence of FlatNodes.
+        std::vector<IndividualEntry> individuals;
+        std::vector<FlatNode> nodes;
+        std::function<void(const GpTree&)> flatten = [&](const GpTree& tree)
+        {
+            FlatNode node = {0, 0, -1, uint32_t(tree.getRootType()->id()), 0};
+            if (tree.isLeaf())
+            {
+                const GpType& type = *tree.getRootType();
+                std::string text = type.identityString(tree.getRootValue());
+                node.leaf_offset = add_string(text);
+                node.leaf_size = uint32_t(text.size());
+            }
+            else
+            {
+                node.function = tree.getRootFunction().id();
+            }
+            nodes.push_back(node);
+            for (auto& subtree : tree.subtrees()) { flatten(subtree); }
+        };
+        for (int s = 0; s < population.getSubpopulationCount(); s++)
+        {
+            const Population::SubPop& subpop = population.subpopulation(s);
+            for (size_t i = 0; i < subpop.size(); i++)
+            {
+                Individual* individual = subpop.at(i);
+                uint64_t first_node = nodes.size();
+                flatten(individual->tree());
+                individuals.push_back({first_node,
+                                       uint32_t(nodes.size() - first_node),
+                                       uint32_t(s),
+                                       uint32_t(i),
+                                       individual->getTournamentsSurvived(),
+                                       individual->getFitness(),
+                                       individual->hasFitness(),
+                                       individual->getStanding(),
+                                       0});
+            }
+        }
+        // Fill in header with counts and section offsets.
+        Header header = {};
+        std::copy(magic(), magic() + 8, header.magic);
+        header.version = version();
+        header.byte_order = byteOrder();
+        header.step_count = population.getStepCount();
+        header.subpopulation_count = population.getSubpopulationCount();
+        header.individual_count = uint32_t(individuals.size());
+        header.type_count = uint32_t(types.size());
+        header.function_count = uint32_t(functions.size());
+        header.node_count = nodes.size();
+        header.string_bytes = strings.size();
+        header.types_offset = align(sizeof(Header));
+        header.functions_offset = align(header.types_offset +
+                                        types.size() * sizeof(TypeEntry));
+        header.individuals_offset = align(header.functions_offset +
+                                          functions.size() *
+                                          sizeof(FunctionEntry));
+        header.nodes_offset = align(header.individuals_offset +
+                                    individuals.size() *
+                                    sizeof(IndividualEntry));
+        header.strings_offset = align(header.nodes_offset +
+                                      nodes.size() * sizeof(FlatNode));
+        header.max_init_tree_size = population.getMaxInitTreeSize();
+        header.min_crossover_tree_size = population.getMinCrossoverTreeSize();
+        header.max_crossover_tree_size = population.getMaxCrossoverTreeSize();
+        header.migration_likelihood = population.getMigrationLikelihood();
+        // Write each section, padded to its offset, into a temporary file in
+        // the same directory, then rename it so "pathname" is never partial.
+        std::string temp = pathname + "." + std::to_string(getpid()) + ".tmp";
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        auto write_section = [&](uint64_t offset, const void* data, size_t size)
+        {
+            while (uint64_t(stream.tellp()) < offset) { stream.put(0); }
+            stream.write(static_cast<const char*>(data), size);
+        };
+        write_section(0, &header, sizeof(Header));
+        write_section(header.types_offset, types.data(),
+                      types.size() * sizeof(TypeEntry));
+        write_section(header.functions_offset, functions.data(),
+                      functions.size() * sizeof(FunctionEntry));
+        write_section(header.individuals_offset, individuals.data(),
+                      individuals.size() * sizeof(IndividualEntry));
+        write_section(header.nodes_offset, nodes.data(),
+                      nodes.size() * sizeof(FlatNode));
+        write_section(header.strings_offset, strings.data(), strings.size());
+        bool ok = bool(stream.flush());
+        stream.close();
+        ok = ok && (std::rename(temp.c_str(), pathname.c_str()) == 0);
+        if (!ok) { std::remove(temp.c_str()); }
+        return ok;
+    }
+
+    // Map the snapshot file at "pathname" for reading. Check valid() after.
+    PopulationSnapshot(const std::string& pathname) : file_(pathname)
+    {
+        header_ = file_.at<Header>(0);
+        if (header_ &&
+            std::equal(magic(), magic() + 8, header_->magic) &&
+            header_->version == version() &&
+            header_->byte_order == byteOrder())
+        {
+            types_ = file_.at<TypeEntry>(header_->types_offset,
+                                         header_->type_count);
+            functions_ = file_.at<FunctionEntry>(header_->functions_offset,
+                                                 header_->function_count);
+            individuals_ = file_.at<IndividualEntry>
+                (header_->individuals_offset, header_->individual_count);
+            nodes_ = file_.at<FlatNode>(header_->nodes_offset,
+                                        header_->node_count);
+            strings_ = file_.at<char>(header_->strings_offset,
+                                      header_->string_bytes);
+        }
+        valid_ = (types_ && functions_ && individuals_ && nodes_ && strings_ &&
+                  validTables());
+    }
+    // Was snapshot file successfully mapped, is it in the current format, and
+    // are all IDs, node ranges and string ranges in its tables in bounds?
+    bool valid() const { return valid_; }
+
+    // Read-only in-place access to snapshot data.
+    const Header& header() const { return *header_; }
+    int getIndividualCount() const { return header_->individual_count; }
+    int getSubpopulationCount() const { return header_->subpopulation_count; }
+    int getStepCount() const { return int(header_->step_count); }
+    const IndividualEntry& individual(int i) const
+    {
+        assert(i < getIndividualCount());
+        return individuals_[i];
+    }
+    // First FlatNode of i-th Individual's tree (followed by node_count-1 more).
+    const FlatNode* treeNodes(int i) const
+    {
+        return nodes_ + individual(i).first_node;
+    }
+    std::string_view typeName(uint32_t id) const
+    {
+        assert(id < header_->type_count);
+        return string(types_[id].name_offset, types_[id].name_size);
+    }
+    std::string_view functionName(uint32_t id) const
+    {
+        assert(id < header_->function_count);
+        return string(functions_[id].name_offset, functions_[id].name_size);
+    }
+    int functionArity(uint32_t id) const
+    {
+        assert(id < header_->function_count);
+        return functions_[id].arity;
+    }
+    std::string_view leafText(const FlatNode& node) const
+    {
+        return string(node.leaf_offset, node.leaf_size);
+    }
+
+    // Map the GpType/GpFunction names in header tables to objects in "fs".
+    // Must be called before using makeGpTree() or makePopulation(). Returns
+    // false (and the snapshot becomes invalid) if "fs" does not match: a name
+    // is unknown, or a GpFunction's arity or return type differs.
+    bool resolve(const FunctionSet& fs)
+    {
+        function_set_ = nullptr;
+        gp_types_.clear();
+        gp_functions_.clear();
+        bool ok = valid();
+        for (uint32_t i = 0; ok && (i < header_->type_count); i++)
+        {
+            const GpType* type = fs.findGpTypeByName(std::string(typeName(i)));
+            gp_types_.push_back(type);
+            ok = (type != nullptr);
+        }
+        for (uint32_t i = 0; ok && (i < header_->function_count); i++)
+        {
+            std::string name(functionName(i));
+            const GpFunction* function = fs.findGpFunctionByName(name);
+            gp_functions_.push_back(function);
+            ok = (function &&
+                  (function->parameterTypes().size() == functions_[i].arity) &&
+                  (functions_[i].return_type < gp_types_.size()) &&
+                  (function->returnType() ==
+                   gp_types_[functions_[i].return_type]));
+        }
+        if (ok) { function_set_ = &fs; } else { valid_ = false; }
+        return ok;
+    }
+
+    // Rebuild the i-th Individual's tree as a GpTree (requires resolve()).
+    // Returns false if the snapshot data is malformed, or a leaf value cannot
+    // be parsed (its GpType has no from_string, or rejects the text).
+    bool makeGpTree(int i, GpTree& gp_tree) const
+    {
+        assert("call resolve() first" && function_set_);
+        const FlatNode* next = treeNodes(i);
+        const FlatNode* end = next + individual(i).node_count;
+        std::function<bool(GpTree&)> unflatten = [&](GpTree& tree)
+        {
+            if (next >= end) { return false; }
+            const FlatNode& node = *next++;
+            if (node.type >= gp_types_.size()) { return false; }
+            const GpType& type = *gp_types_[node.type];
+            if (node.isLeaf())
+            {
+                if (!type.hasFromString()) { return false; }
+                std::any value = type.from_string(std::string(leafText(node)));
+                if (!value.has_value()) { return false; }
+                tree.setRootValue(value, type);
+            }
+            else
+            {
+                if (size_t(node.function) >= gp_functions_.size())
+                {
+                    return false;
+                }
+                const GpFunction& function = *gp_functions_[node.function];
+                tree.setRootFunction(function);
+                tree.addSubtrees(function.parameterTypes().size());
+                for (auto& subtree : tree.subtrees())
+                {
+                    if (!unflatten(subtree)) { return false; }
+                }
+            }
+            return true;
+        };
+        return unflatten(gp_tree) && (next == end);
+    }
+
+    // Make a new Population equivalent to the one from which this snapshot
+    // was written, to restart a run (requires resolve()). Returns nullptr if
+    // any tree cannot be rebuilt, see makeGpTree().
+    std::unique_ptr<Population> makePopulation() const
+    {
+        assert("call resolve() first" && function_set_);
+        auto population = std::make_unique<Population>
+            (getIndividualCount(),
+             getSubpopulationCount(),
+             0,
+             header_->min_crossover_tree_size,
+             header_->max_crossover_tree_size,
+             function_set_);
+        population->setMaxInitTreeSize(header_->max_init_tree_size);
+        population->setMigrationLikelihood(header_->migration_likelihood);
+        population->setStepCount(getStepCount());
+        for (int i = 0; i < getIndividualCount(); i++)
+        {
+            const IndividualEntry& entry = individual(i);
+            auto& subpop = population->subpopulation(entry.subpopulation);
+            GpTree gp_tree;
+            if ((entry.index_in_subpopulation >= subpop.size()) ||
+                !makeGpTree(i, gp_tree))
+            {
+                return nullptr;
+            }
+            Individual* restored = new Individual(gp_tree);
+            restored->setTournamentsSurvived(entry.tournaments_survived);
+            restored->setStanding(entry.standing);
+            if (entry.has_fitness) { restored->setFitness(entry.fitness); }
+            population->replaceIndividual(entry.index_in_subpopulation,
+                                          restored,
+                                          subpop);
+        }
+        return population;
+    }
+
+    // Identifies snapshot files and their format version.
+    static const char* magic() { return "LPSNAP\0\0"; }
+    static uint32_t version() { return 2; }
+    static uint32_t byteOrder() { return 0x01020304; }
+private:
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + 7) & ~uint64_t(7);
+    }
+    std::string_view string(uint64_t offset, uint32_t size) const
+    {
+        assert(validString(offset, size));
+        return std::string_view(strings_ + offset, size);
+    }
+    bool validString(uint64_t offset, uint32_t size) const
+    {
+        return ((offset <= header_->string_bytes) &&
+                (size <= header_->string_bytes - offset));
+    }
+    // Check every table entry once, when the file is mapped, so accessors
+    // never read outside the file even if it is truncated or corrupt.
+    bool validTables() const
+    {
+        uint32_t type_count = header_->type_count;
+        uint32_t function_count = header_->function_count;
+        uint64_t node_count = header_->node_count;
+        if (header_->subpopulation_count == 0) { return false; }
+        for (uint32_t i = 0; i < type_count; i++)
+        {
+            const TypeEntry& t = types_[i];
+            if (!validString(t.name_offset, t.name_size)) { return false; }
+        }
+        for (uint32_t i = 0; i < function_count; i++)
+        {
+            const FunctionEntry& f = functions_[i];
+            if (!validString(f.name_offset, f.name_size) ||
+                (f.return_type >= type_count))
+            {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < header_->individual_count; i++)
+        {
+            const IndividualEntry& e = individuals_[i];
+            if ((e.first_node > node_count) ||
+                (e.node_count > node_count - e.first_node) ||
+                (e.subpopulation >= header_->subpopulation_count))
+            {
+                return false;
+            }
+        }
+        for (uint64_t i = 0; i < node_count; i++)
+        {
+            const FlatNode& n = nodes_[i];
+            if ((n.type >= type_count) ||
+                (n.isLeaf() ? !validString(n.leaf_offset, n.leaf_size) :
+                              (uint32_t(n.function) >= function_count)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    MappedFile file_;
+    bool valid_ = false;
+    // Pointers into mapped file for each section.
+    const Header* header_ = nullptr;
+    const TypeEntry* types_ = nullptr;
+    const FunctionEntry* functions_ = nullptr;
+    const IndividualEntry* individuals_ = nullptr;
+    const FlatNode* nodes_ = nullptr;
+    const char* strings_ = nullptr;
+    // FunctionSet resolved against, and its objects indexed by snapshot ID.
+    const FunctionSet* function_set_ = nullptr;
+    std::vector<const GpType*> gp_types_;
+    std::vector<const GpFunction*> gp_functions_;
+};
@@ -0,0 +1,162 @@
+//
+//  Racing.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// "Racing" tournaments for fitness which is a sum over many fitness cases. All
+// members of a TournamentGroup are evaluated together, a chunk of cases at a
+// time, and evaluation stops as soon as the tournament's loser (all that
+// Population::evolutionStep() needs) is settled:
+//
+//   Deterministic: the loser's best possible total (given per-case fitness
+//       bounds caseMin() and caseMax()) is below every other member's worst
+//       possible total. Always picks the same loser as evaluating all cases.
+//   Statistical: using Hoeffding bounds, with probability at least 1 - delta()
+//       the loser's mean per-case fitness is below every other member's. Cases
+//       are evaluated in a random order, chosen per tournament. Since the
+//       bound is checked after each chunk, delta() is divided among all
+//       checks (and members) by a union bound.
+//
+// Each member's metric is its mean fitness over the cases evaluated, which are
+// the same for all members. Use tournamentFunction() with evolutionStep().
+
+#pragma once
+#include "Population.h"
+#include <cmath>
+#include <numeric>
+
+class Racing
+{
+public:
+    enum Mode { Deterministic, Statistical };
+    // Fitness of an Individual on one case (0 <= case_index < caseCount()),
+    // bigger is better, in the range [caseMin(), caseMax()].
+    typedef std::function<float(Individual*, int case_index)> CaseFitness;
+
+    Racing(int case_count,
+           CaseFitness case_fitness,
+           float case_min,
+           float case_max,
+           Mode mode = Deterministic)
+      : case_count_(case_count),
+        case_fitness_(case_fitness),
+        case_min_(case_min),
+        case_max_(case_max),
+        mode_(mode)
+    {
+        assert(case_count > 0);
+        assert(case_min <= case_max);
+    }
+    int caseCount() const { return case_count_; }
+    float caseMin() const { return case_min_; }
+    float caseMax() const { return case_max_; }
+    Mode mode() const { return mode_; }
+    // Number of cases evaluated, per member, between checks (default 16).
+    int chunkSize() const { return chunk_size_; }
+    void setChunkSize(int size) { chunk_size_ = std::max(1, size); }
+    // For Statistical mode, allowed probability of picking the wrong loser.
+    float delta() const { return delta_; }
+    void setDelta(float delta) { delta_ = delta; }
+
+    // Race the members of a group. Returns group sorted by metric.
+    TournamentGroup race(TournamentGroup group)
+    {
+        std::vector<TournamentGroupMember> members = group.members();
+        int count = int(members.size());
+        std::vector<double> sums(count, 0);
+        std::vector<int> order(case_count_);
+        std::iota(order.begin(), order.end(), 0);
+        if (mode() == Statistical)
+        {
+            for (int i = case_count_ - 1; i > 0; i--)
+            {
+                std::swap(order[i], order[LPRS().randomN(i + 1)]);
+            }
+        }
+        int done = 0;
+        while ((done < case_count_) && !settled(sums, done))
+        {
+            int end = std::min(case_count_, done + chunkSize());
+            for (int m = 0; m < count; m++)
+            {
+                for (int c = done; c < end; c++)
+                {
+                    sums[m] += case_fitness_(members[m].individual, order[c]);
+                }
+            }
+            done = end;
+        }
+        for (int m = 0; m < count; m++) { members[m].metric = sums[m] / done; }
+        tournaments_++;
+        cases_evaluated_ += done * count;
+        cases_possible_ += case_count_ * count;
+        if (done < case_count_) { early_stops_++; }
+        bool valid = group.getValid();
+        group = TournamentGroup(members);  // Sorts by metric.
+        group.setValid(valid);
+        return group;
+    }
+    // A TournamentFunction for Population::evolutionStep().
+    Population::TournamentFunction tournamentFunction()
+    {
+        return [this](TournamentGroup group) { return race(group); };
+    }
+
+    // Counts of tournaments, of tournaments stopped early, and of case
+    // evaluations done and those that would have been done without racing.
+    int tournaments() const { return tournaments_; }
+    int earlyStops() const { return early_stops_; }
+    int64_t casesEvaluated() const { return cases_evaluated_; }
+    int64_t casesPossible() const { return cases_possible_; }
+
+private:
+    // Is the loser settled, given per-member sums over the first "done" cases?
+    bool settled(const std::vector<double>& sums, int done) const
+    {
+        if ((done == 0) || (sums.size() < 2)) return false;
+        size_t worst = std::min_element(sums.begin(), sums.end()) -
+                       sums.begin();
+        double worst_high = 0;
+        double other_low = 0;
+        if (mode() == Deterministic)
+        {
+            int remaining = case_count_ - done;
+            worst_high = sums[worst] + remaining * double(case_max_);
+            other_low = remaining * double(case_min_);
+        }
+        else
+        {
+            // Hoeffding bound on means, union bound over all members and
+            // over the largest possible number of checks.
+            double checks = std::ceil(double(case_count_) / chunkSize());
+            double range = case_max_ - case_min_;
+            double epsilon = range * std::sqrt(std::log(2 * sums.size() *
+                                                        checks / delta_) /
+                                               (2 * done));
+            worst_high = (sums[worst] / done) + epsilon;
+            other_low = -epsilon;
+        }
+        for (size_t m = 0; m < sums.size(); m++)
+        {
+            if (m == worst) continue;
+            double low = other_low + ((mode() == Deterministic) ?
+                                      sums[m] : sums[m] / done);
+            if (worst_high >= low) return false;
+        }
+        return true;
+    }
+    int case_count_ = 0;
+    CaseFitness case_fitness_ = nullptr;
+    float case_min_ = 0;
+    float case_max_ = 1;
+    Mode mode_ = Deterministic;
+    int chunk_size_ = 16;
+    float delta_ = 0.05;
+    int tournaments_ = 0;
+    int early_stops_ = 0;
+    int64_t cases_evaluated_ = 0;
+    int64_t cases_possible_ = 0;
+};
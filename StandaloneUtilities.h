@@ -0,0 +1,124 @@
+//
+//  StandaloneUtilities.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Minimal versions of the utilities LazyPredator normally shares with TexSyn
+// (see Utilities.h), so that LazyPredator can be built on its own, without a
+// sibling TexSyn checkout, for example for the benchmark and unit test targets
+// in CMakeLists.txt. These have the same interface as the TexSyn versions but
+// RandomSequence produces different sequences for a given seed.
+
+#pragma once
+#include <any>
+#include <set>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cassert>
+#include <cstdint>
+
+// Print expression and its value, for debugging.
+#define debugPrint(e) { std::cout << #e" = " << (e) << std::endl << std::flush; }
+
+// Convert std::any holding a T to string.
+template <typename T> std::string any_to_string(std::any a)
+{
+    std::stringstream ss;
+    ss << std::any_cast<T>(a);
+    return ss.str();
+}
+
+// True when x is between a and b (inclusive) in either order.
+template <typename T> bool between(T x, double a, double b)
+{
+    return (x >= std::min(a, b)) && (x <= std::max(a, b));
+}
+
+// True when set contains the given element.
+template <typename T> bool set_contains(const std::set<T>& set, const T& e)
+{
+    return set.find(e) != set.end();
+}
+
+// Time and duration types.
+typedef std::chrono::high_resolution_clock TimeClock;
+typedef std::chrono::time_point<TimeClock> TimePoint;
+typedef std::chrono::duration<double> TimeDuration;
+
+// Prints description and elapsed time (seconds) at end of Timer's lifetime.
+class Timer
+{
+public:
+    Timer(const std::string& description)
+      : description_(description), start_time_(TimeClock::now()) {}
+    ~Timer()
+    {
+        TimeDuration elapsed_time = TimeClock::now() - start_time_;
+        std::cout << description_ << elapsed_time.count() << std::endl;
+    }
+private:
+    std::string description_;
+    TimePoint start_time_;
+};
+
+// Deterministic pseudo-random sequence, state is a 32 bit integer which is
+// rehashed for each new value.
+class RandomSequence
+{
+public:
+    RandomSequence() { setSeed(); }
+    RandomSequence(uint64_t seed) { setSeed(seed); }
+    // Next random number in sequence as a 32 bit unsigned int.
+    uint32_t nextInt() { state_ = rehash32bits(state_); return state_; }
+    // Random float uniformly distributed on [0, 1].
+    float frandom01() { return float(nextInt()) / float(UINT32_MAX); }
+    // Random float uniformly distributed between a and b.
+    float frandom2(float a, float b)
+    {
+        float low = std::min(a, b);
+        float high = std::max(a, b);
+        return low + ((high - low) * frandom01());
+    }
+    // Random int uniformly distributed on [i, j] (inclusive).
+    int random2(int i, int j)
+    {
+        int low = std::min(i, j);
+        uint32_t range = uint32_t(std::max(i, j) - low) + 1;
+        return low + int(nextInt() % range);
+    }
+    float random2(float a, float b) { return frandom2(a, b); }
+    // Random int on [0, n-1].
+    int randomN(int n) { return int(nextInt() % uint32_t(n)); }
+    // True with given likelihood.
+    bool randomBool(float likelihood = 0.5) { return frandom01() < likelihood; }
+    // Random element of vector.
+    template <typename T> T randomSelectElement(const std::vector<T>& vector)
+    {
+        return vector.at(randomN(int(vector.size())));
+    }
+    // Set seed (initial state) of sequence.
+    void setSeed() { setSeed(defaultSeed()); }
+    void setSeed(uint64_t seed) { state_ = uint32_t(seed ^ (seed >> 32)); }
+    static uint64_t defaultSeed() { return 688395321; }
+private:
+    // Integer hash (from "MurmurHash3" finalizer) offset so zero is not fixed.
+    static uint32_t rehash32bits(uint32_t u)
+    {
+        u ^= u >> 16;
+        u *= 0x85ebca6b;
+        u ^= u >> 13;
+        u *= 0xc2b2ae35;
+        u ^= u >> 16;
+        return u + 0x9e3779b9;
+    }
+    uint32_t state_ = 0;
+};
@@ -0,0 +1,170 @@
+//
+//  Surrogate.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// A surrogate model predicts an offspring's fitness from cheap features of its
+// GpTree and its parents' fitness. It is trained online from real evaluations.
+// With a surrogate set (Population::setSurrogate()) each evolutionStep() makes
+// several candidate offspring and keeps the one with highest predicted
+// fitness, so expensive evaluation is spent on the most promising. Only used
+// with "absolute fitness" (FitnessFunction or BatchFitnessFunction) since that
+// provides the training data.
+//
+// SurrogateModel is the pluggable interface. LinearSurrogate is a linear model
+// trained by normalized least mean squares. Its features are: tree size and
+// depth, a histogram of GpFunction usage, a hashed histogram of the shapes of
+// subtrees (hashes of functions and leaf types, ignoring leaf values, so that
+// subtrees inherited from parents are recognized), and parental fitness.
+// Fitness and parental fitness are standardized with running statistics.
+
+#pragma once
+#include "FunctionSet.h"
+#include <cmath>
+
+class SurrogateModel
+{
+public:
+    virtual ~SurrogateModel() {}
+    // Predicted fitness of a tree whose parents' average fitness is given (NaN
+    // if unknown).
+    virtual float predict(const GpTree& tree, float parent_fitness) = 0;
+    // Learn from one real evaluation.
+    virtual void train(const GpTree& tree,
+                       float parent_fitness,
+                       float fitness) = 0;
+    // Number of training examples seen so far.
+    virtual int trainingSamples() const = 0;
+};
+
+class LinearSurrogate : public SurrogateModel
+{
+public:
+    LinearSurrogate(const FunctionSet& function_set,
+                    int hash_buckets = 32,
+                    float learning_rate = 0.1)
+      : function_count_(int(function_set.gpFunctions().size())),
+        hash_buckets_(hash_buckets),
+        learning_rate_(learning_rate),
+        weights_(featureCount(), 0) {}
+
+    float predict(const GpTree& tree, float parent_fitness) override
+    {
+        features(tree, parent_fitness, features_);
+        predictions_++;
+        return (dot(features_) * fitness_.deviation()) + fitness_.mean();
+    }
+    void train(const GpTree& tree,
+               float parent_fitness,
+               float fitness) override
+    {
+        fitness_.add(fitness);
+        if (!std::isnan(parent_fitness))
+        {
+            parent_fitness_.add(parent_fitness);
+        }
+        features(tree, parent_fitness, features_);
+        float target = (fitness - fitness_.mean()) / fitness_.deviation();
+        float error = target - dot(features_);
+        float norm = dot(features_, features_) + 1e-6;
+        for (int i = 0; i < featureCount(); i++)
+        {
+            weights_[i] += learning_rate_ * error * features_[i] / norm;
+        }
+        // Running mean absolute error (in fitness units) of predictions.
+        float weight = 1.0f / std::min(training_samples_ + 1, 100);
+        abs_error_ += weight * ((std::abs(error) * fitness_.deviation()) -
+                                abs_error_);
+        training_samples_++;
+    }
+    int trainingSamples() const override { return training_samples_; }
+    int predictions() const { return predictions_; }
+    // Recent mean absolute training error, before each update.
+    float meanAbsoluteError() const { return abs_error_; }
+
+    // Feature vector for a tree: bias, size, depth, parent fitness, function
+    // histogram, subtree shape histogram.
+    int featureCount() const { return 4 + function_count_ + hash_buckets_; }
+    void features(const GpTree& tree,
+                  float parent_fitness,
+                  std::vector<float>& result) const
+    {
+        result.assign(featureCount(), 0);
+        int size = tree.size();
+        result[0] = 1;
+        result[1] = size / 100.0f;
+        result[2] = tree.depth() / 20.0f;
+        result[3] = (std::isnan(parent_fitness) ? 0 :
+                     ((parent_fitness - parent_fitness_.mean()) /
+                      parent_fitness_.deviation()));
+        int subtrees = 0;
+        shapeHash(tree, result, subtrees);
+        for (int i = 4; i < 4 + function_count_; i++) { result[i] /= size; }
+        for (int i = 4 + function_count_; i < featureCount(); i++)
+        {
+            result[i] /= std::max(1, subtrees);
+        }
+    }
+
+private:
+    // Count function usage and subtree shapes into "result", return hash of
+    // tree's shape.
+    size_t shapeHash(const GpTree& tree,
+                     std::vector<float>& result,
+                     int& subtrees) const
+    {
+        if (tree.isLeaf()) { return 0x9e3779b9 + tree.getRootType()->id(); }
+        int id = tree.getRootFunction().id();
+        result[4 + id] += 1;
+        size_t hash = std::hash<int>()(id);
+        for (auto& subtree : tree.subtrees())
+        {
+            hash = hash * 31 + shapeHash(subtree, result, subtrees);
+        }
+        result[4 + function_count_ + (hash % hash_buckets_)] += 1;
+        subtrees++;
+        return hash;
+    }
+    float dot(const std::vector<float>& x) const { return dot(weights_, x); }
+    static float dot(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        float sum = 0;
+        for (size_t i = 0; i < a.size(); i++) { sum += a[i] * b[i]; }
+        return sum;
+    }
+    // Running mean and standard deviation (Welford).
+    class RunningStats
+    {
+    public:
+        void add(float x)
+        {
+            count_++;
+            double delta = x - mean_;
+            mean_ += delta / count_;
+            m2_ += delta * (x - mean_);
+        }
+        float mean() const { return mean_; }
+        float deviation() const
+        {
+            double variance = (count_ > 1) ? m2_ / (count_ - 1) : 0;
+            return (variance > 0) ? std::sqrt(variance) : 1;
+        }
+    private:
+        int count_ = 0;
+        double mean_ = 0;
+        double m2_ = 0;
+    };
+    int function_count_ = 0;
+    int hash_buckets_ = 32;
+    float learning_rate_ = 0.1;
+    std::vector<float> weights_;
+    std::vector<float> features_;
+    RunningStats fitness_;
+    RunningStats parent_fitness_;
+    int training_samples_ = 0;
+    int predictions_ = 0;
+    float abs_error_ = 0;
+};
@@ -0,0 +1,312 @@
+//
+//  ThreadPool.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// A work-stealing pool of worker threads. Each worker has its own deque of
+// tasks: it runs the newest task from its own deque, and when that is empty
+// "steals" the oldest task from another's. Tasks are run in a TaskGroup, whose
+// wait() runs queued tasks while waiting for the group to finish, so tasks can
+// themselves run and wait for nested TaskGroups (such as subtrees of a GpTree
+// during GpTree::evalParallel()) without deadlock.
+//
+// shared() is one pool for all LazyPredator parallel operations (unless given
+// another, see Population::setThreadPool()), so they do not oversubscribe the
+// machine's cores. Fitness code can submit its own work to it too. A start
+// hook, run on each worker thread as it starts, can set its affinity (see
+// pinCurrentThread()). Each worker has its own LPRS() sequence, see
+// LP::LocalRandomSequence, seeded from its index and a value taken from LPRS()
+// when the pool is made.
+
+#pragma once
+#include "Utilities.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+    // Called on each worker thread as it starts, with its index.
+    typedef std::function<void(int worker_index)> StartHook;
+
+    // Make pool with given number of worker threads (default: one per core).
+    ThreadPool(int thread_count = 0, StartHook start_hook = nullptr)
+      : start_hook_(start_hook)
+    {
+        if (thread_count <= 0)
+        {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        // So workers of different pools have different LPRS() sequences.
+        seed_ = LPRS().nextInt();
+        // One deque per worker, plus one shared by threads outside the pool.
+        for (int i = 0; i <= thread_count; i++)
+        {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+        for (int i = 0; i < thread_count; i++)
+        {
+            threads_.emplace_back([this, i](){ workerLoop(i); });
+        }
+        // Wait until each worker has started (and run start hook).
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [&](){ return started_ == thread_count; });
+    }
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_) { thread.join(); }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int threadCount() const { return int(threads_.size()); }
+    // Is calling thread one of this pool's workers?
+    bool onWorkerThread() const { return worker_pool_ == this; }
+    // Index of calling thread among workers of its pool, or -1 if not one.
+    static int workerIndex() { return worker_pool_ ? worker_index_ : -1; }
+
+    // The pool shared by all LazyPredator parallel operations, made on first
+    // use with setSharedThreadCount() workers (default: one per core).
+    static ThreadPool& shared()
+    {
+        std::lock_guard<std::mutex> lock(shared_mutex_);
+        if (!shared_pool_)
+        {
+            shared_pool_ = std::make_unique<ThreadPool>(shared_thread_count_,
+                                                        shared_start_hook_);
+        }
+        return *shared_pool_;
+    }
+    // Configure shared(), only before its first use.
+    static void setSharedThreadCount(int thread_count,
+                                     StartHook start_hook = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(shared_mutex_);
+        assert("shared pool already made" && !shared_pool_);
+        shared_thread_count_ = thread_count;
+        shared_start_hook_ = start_hook;
+    }
+    // Affinity helper for a StartHook: restrict calling thread to one CPU (or
+    // to a set of CPUs). Returns false if that failed or is not supported on
+    // this platform.
+    static bool pinCurrentThread(int cpu)
+    {
+        return pinCurrentThread(std::vector<int>({cpu}));
+    }
+    static bool pinCurrentThread(const std::vector<int>& cpus)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) { CPU_SET(cpu, &set); }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+
+    // Number of tasks run, and how many of those were stolen.
+    int64_t tasksRun() const { return tasks_run_; }
+    int64_t steals() const { return steals_; }
+
+    // Call function(i) for each i in [begin, end), in tasks of "grain"
+    // consecutive indices, returning when all are done.
+    void parallelFor(int begin,
+                     int end,
+                     const std::function<void(int)>& function,
+                     int grain = 1)
+    {
+        grain = std::max(1, grain);
+        TaskGroup group(*this);
+        for (int first = begin; first < end; first += grain)
+        {
+            int last = std::min(end, first + grain);
+            group.run([&function, first, last]()
+            {
+                for (int i = first; i < last; i++) { function(i); }
+            });
+        }
+        group.wait();
+    }
+
+    // A set of tasks run on a pool. wait() (also called by destructor) returns
+    // when all have finished, rethrowing the first exception thrown by any.
+    // Unless "help" is false, the waiting thread runs queued tasks meanwhile
+    // (false ensures this group's tasks run only on the pool's workers).
+    class TaskGroup
+    {
+    public:
+        TaskGroup(ThreadPool& pool, bool help = true)
+          : pool_(pool), help_(help) {}
+        ~TaskGroup() { waitForTasks(); }
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+        void run(Task task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending_++;
+            }
+            pool_.push([this, task]()
+            {
+                try { task(); }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!error_) { error_ = std::current_exception(); }
+                }
+                // Last use of "this", waiter may then destroy the group.
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--pending_ == 0) { done_.notify_all(); }
+            });
+        }
+        void wait()
+        {
+            waitForTasks();
+            std::exception_ptr error = nullptr;
+            std::swap(error, error_);
+            if (error) { std::rethrow_exception(error); }
+        }
+    private:
+        // Run tasks from pool (this group's or others) until group is done.
+        void waitForTasks()
+        {
+            while (true)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (pending_ == 0) { return; }
+                }
+                if (!(help_ && pool_.runOneTask()))
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    done_.wait_for(lock, std::chrono::milliseconds(1),
+                                   [&](){ return pending_ == 0; });
+                }
+            }
+        }
+        ThreadPool& pool_;
+        bool help_ = true;
+        std::mutex mutex_;
+        std::condition_variable done_;
+        int pending_ = 0;
+        std::exception_ptr error_ = nullptr;
+    };
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    // Index of calling thread's own deque: its worker index, or the shared
+    // deque for threads not in this pool.
+    int queueIndex() const
+    {
+        return (worker_pool_ == this) ? worker_index_ : threadCount();
+    }
+    void push(Task task)
+    {
+        Queue& queue = *queues_[queueIndex()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            queued_++;
+        }
+        wake_.notify_one();
+    }
+    // Run one task: newest from own deque, else oldest from another. Returns
+    // false if no task was found.
+    bool runOneTask()
+    {
+        int self = queueIndex();
+        int count = int(queues_.size());
+        Task task = nullptr;
+        for (int i = 0; !task && (i < count); i++)
+        {
+            Queue& queue = *queues_[(self + i) % count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                if (i == 0)
+                {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else
+                {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                    steals_++;
+                }
+            }
+        }
+        if (!task) { return false; }
+        queued_--;
+        tasks_run_++;
+        task();
+        return true;
+    }
+    void workerLoop(int index)
+    {
+        worker_pool_ = this;
+        worker_index_ = index;
+        // Private LPRS() for this worker, not touching the global sequence.
+        LP::LocalRandomSequence random((uint64_t(seed_) << 32) ^
+                                       (0x9e3779b97f4a7c15ULL * (index + 1)));
+        if (start_hook_) { start_hook_(index); }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            started_++;
+        }
+        wake_.notify_all();
+        while (true)
+        {
+            if (runOneTask()) continue;
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            wake_.wait(lock, [&](){ return stop_ || (queued_ > 0); });
+            if (stop_) break;
+        }
+    }
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    StartHook start_hook_ = nullptr;
+    // Per-pool part of workers' LPRS() seeds, taken from LPRS().
+    uint32_t seed_ = 0;
+    // Workers sleep when no tasks are queued.
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<int> queued_ = 0;
+    int started_ = 0;
+    bool stop_ = false;
+    std::atomic<int64_t> tasks_run_ = 0;
+    std::atomic<int64_t> steals_ = 0;
+    // Pool and index of calling thread, if it is a worker.
+    static inline thread_local ThreadPool* worker_pool_ = nullptr;
+    static inline thread_local int worker_index_ = 0;
+    // For shared().
+    static inline std::mutex shared_mutex_;
+    static inline std::unique_ptr<ThreadPool> shared_pool_;
+    static inline int shared_thread_count_ = 0;
+    static inline StartHook shared_start_hook_ = nullptr;
+};
@@ -116,6 +116,20 @@ public:
     // can set to false, canceling tournament, so leaving population unchanged.
     bool getValid() const { return valid_; }
     void setValid(bool new_validity) { valid_ = new_validity; }
+    // Sort members by metric, breaking ties by tree size, so that among
+    // members with equal metrics the largest tree is worst.
+    void sortWithParsimony()
+    {
+        auto sorted = [](const TournamentGroupMember &a,
+                         const TournamentGroupMember &b)
+        {
+            return ((a.metric < b.metric) ||
+                    ((a.metric == b.metric) &&
+                     (a.individual->tree().size() >
+                      b.individual->tree().size())));
+        };
+        std::stable_sort(members_.begin(), members_.end(), sorted);
+    }
 private:
     // Sort the members of this group by their "metric" value.
     void sort()
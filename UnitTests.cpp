@@ -73,7 +73,7 @@ bool gp_function_weighted_select()
 {
     bool result = true;
     LPRS().setSeed(46102969);
-    auto eval_zero = [](GpTree& t) { return std::any(0); };
+    auto eval_zero = [](GpTree&) { return std::any(0); };
     // Define FunctionSet with random selection weightings.
     FunctionSet fs = { { { "Int", 0, 9 } },
                        { { "L", "Int", {"Int"}, eval_zero, 0.5 },
@@ -96,7 +96,7 @@ bool gp_function_weighted_select()
         counts.at(f)++;
     }
     // Compare counts per pair of GpFunctions, expect next to be twice as much.
-    for (int i = 1; i < counts.size(); i ++)
+    for (size_t i = 1; i < counts.size(); i ++)
     {
         int a = counts.at(functions.at(i - 1));
         int b = counts.at(functions.at(i));
@@ -315,7 +315,7 @@ bool gp_tree_utility()
         for (GpTree* t : vector_of_subtrees) { set_of_subtrees.insert(t); }
         gp_tree.collectSetOfTypes(set_of_types);
         // Verify that set_of_subtrees.size() is equal ro gp_tree.size().
-        ok = ok && st(gp_tree.size() == set_of_subtrees.size());
+        ok = ok && st(gp_tree.size() == int(set_of_subtrees.size()));
         // Traverse a GpTree, testing each node for membership in both sets.
         std::function<void(GpTree*)> check = [&](GpTree* t)
         {
@@ -357,7 +357,7 @@ bool subpopulation_and_stats()
     // Test getStepCount().
     {
         Population p(10, 2, 10, fs);
-        p.setLoggerFunction([](Population& p){});  // Do nothing logger.
+        p.setLoggerFunction([](Population&){});  // Do nothing logger.
         int steps = 10;
         p.run(steps, [](TournamentGroup tg){ return tg; });  // Identity tf.
         ok = ok && st(p.getStepCount() == steps);
@@ -454,6 +454,1919 @@ bool subpopulation_migration()
     return ok;
 }
 
+bool population_snapshot()
+{
+    bool ok = true;
+    LPRS().setSeed(81730264);
+    const FunctionSet& fs = TestFS::treeEval();
+    std::string pathname = "/tmp/lazy_predator_unit_test_snapshot.lpsnap";
+    // Make a Population, give some Individuals fitness, write its snapshot.
+    Population p(50, 3, 30, fs);
+    p.setLoggerFunction([](Population&){});  // Do nothing logger.
+    p.run(20, [](TournamentGroup tg){ return tg; });  // Identity tf.
+    for (int i = 0; i < 10; i++) { p.subpopulation(0).at(i)->setFitness(i); }
+    p.subpopulation(1).at(0)->setStanding(7);
+    ok = ok && st(PopulationSnapshot::write(p, pathname));
+    // Map snapshot file, verify its contents in place and after resolving.
+    {
+        PopulationSnapshot snapshot(pathname);
+        ok = ok && st(snapshot.valid());
+        ok = ok && st(snapshot.getIndividualCount() == p.getIndividualCount());
+        ok = ok && st(snapshot.getStepCount() == p.getStepCount());
+        ok = ok && st(snapshot.resolve(fs));
+        auto restored = snapshot.makePopulation();
+        ok = ok && st(restored != nullptr);
+        for (int i = 0; i < snapshot.getIndividualCount(); i++)
+        {
+            const auto& entry = snapshot.individual(i);
+            Individual* original = p.subpopulation(entry.subpopulation).
+                                     at(entry.index_in_subpopulation);
+            Individual* copy = restored->subpopulation(entry.subpopulation).
+                                 at(entry.index_in_subpopulation);
+            GpTree gp_tree;
+            ok = ok && st(snapshot.makeGpTree(i, gp_tree));
+            ok = ok && st(int(entry.node_count) == original->tree().size());
+            ok = ok && st(gp_tree.to_string() == original->tree().to_string());
+            ok = ok && st(copy->tree().to_string() == gp_tree.to_string());
+            ok = ok && st(copy->getFitness() == original->getFitness());
+            ok = ok && st(copy->hasFitness() == original->hasFitness());
+            ok = ok && st(copy->getStanding() == original->getStanding());
+            // Leaf values are exact, so trees are identical.
+            WireWriter copy_wire;
+            WireWriter original_wire;
+            copy_wire.writeTree(copy->tree());
+            original_wire.writeTree(original->tree());
+            ok = ok && st(copy_wire.message() == original_wire.message());
+        }
+    }
+    // Resolving against a FunctionSet with other names fails.
+    ok = ok && st(!PopulationSnapshot(pathname).resolve(TestFS::crossover()));
+    // Written via a temporary file which does not remain.
+    std::string temp = pathname + "." + std::to_string(getpid()) + ".tmp";
+    ok = ok && st(!std::filesystem::exists(temp));
+    // Truncated or corrupt files are rejected when mapped.
+    {
+        std::string bad = pathname + ".bad";
+        std::ifstream in(pathname, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)),
+                          std::istreambuf_iterator<char>());
+        PopulationSnapshot snapshot(pathname);
+        PopulationSnapshot::Header h = snapshot.header();
+        size_t node_size = sizeof(PopulationSnapshot::FlatNode);
+        uint64_t leaf = snapshot.individual(0).first_node;
+        while (!snapshot.treeNodes(0)[leaf].isLeaf()) { leaf++; }
+        auto corrupt = [&](uint64_t offset, uint32_t value)
+        {
+            std::string copy = bytes;
+            std::memcpy(&copy[offset], &value, sizeof(value));
+            std::ofstream(bad, std::ios::binary) << copy;
+            return !PopulationSnapshot(bad).valid();
+        };
+        std::ofstream(bad, std::ios::binary) << bytes.substr(0, h.nodes_offset);
+        ok = ok && st(!PopulationSnapshot(bad).valid());
+        // Node range of first Individual past end of node table.
+        ok = ok && st(corrupt(h.individuals_offset + 8, ~uint32_t(0)));
+        // Text of a leaf past end of string table.
+        ok = ok && st(corrupt(h.nodes_offset + leaf * node_size + 8,
+                              uint32_t(h.string_bytes + 1)));
+        // GpFunction ID and return type out of range.
+        ok = ok && st(corrupt(h.nodes_offset + 12, h.function_count));
+        ok = ok && st(corrupt(h.functions_offset + 12, h.type_count));
+        ok = ok && st(!corrupt(h.functions_offset + 12, 0));
+        std::remove(bad.c_str());
+    }
+    std::remove(pathname.c_str());
+    // A missing or malformed file should be rejected.
+    ok = ok && st(!PopulationSnapshot(pathname).valid());
+    return ok;
+}
+
+bool gp_tree_parser()
+{
+    bool ok = true;
+    LPRS().setSeed(50912837);
+    const FunctionSet& fs = TestFS::treeEval();
+    // Write many random trees to a stream, in both formats, then parse them
+    // back and verify that they match the originals.
+    std::vector<GpTree> trees(100);
+    std::stringstream stream;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+        fs.makeRandomTree(LPRS().random2(5, 60), trees.at(i));
+        stream << trees.at(i).to_string(i % 2) << std::endl;
+    }
+    GpTreeParser parser(fs, stream);
+    int count = 0;
+    parser.parseAll([&](GpTree& t)
+    {
+        ok = ok && st(t.to_string() == trees.at(count++).to_string());
+    });
+    ok = ok && st(count == int(trees.size())) && st(!parser.error());
+    // Verify a simple program evaluates correctly after being parsed.
+    GpTree gp_tree;
+    std::string source = "Mult(1.5, AddInt(1, Floor(2.5)))";
+    ok = ok && st(GpTreeParser::parse(fs, source, gp_tree));
+    ok = ok && st(std::any_cast<float>(gp_tree.eval()) == 4.5);
+    // Verify errors are detected: type mismatch, bad literal, bad syntax.
+    ok = ok && st(!GpTreeParser::parse(fs, "AddInt(1, 2)", gp_tree));
+    ok = ok && st(!GpTreeParser::parse(fs, "Sqrt(0.5)", gp_tree));
+    ok = ok && st(!GpTreeParser::parse(fs, "Sqrt(Foo(1))", gp_tree));
+    ok = ok && st(!GpTreeParser::parse(fs, "Mult(0.5 2)", gp_tree));
+    ok = ok && st(!GpTreeParser::parse(fs, "Mult(0.5, 2", gp_tree));
+    // Nesting deeper than maxDepth() is an error, not a stack overflow.
+    std::string deep;
+    for (int i = 0; i < 1500; i++) { deep += "AddFloat("; }
+    deep += "0.5";
+    for (int i = 0; i < 1500; i++) { deep += ", 0.5)"; }
+    ok = ok && st(!GpTreeParser::parse(fs, deep, gp_tree));
+    std::istringstream deep_stream(deep);
+    GpTreeParser deep_parser(fs, deep_stream);
+    deep_parser.setMaxDepth(2000);
+    ok = ok && st(deep_parser.parseNext(gp_tree));
+    ok = ok && st(gp_tree.size() == 3001);
+    return ok;
+}
+
+bool gp_tree_to_string()
+{
+    bool ok = true;
+    GpTree gp_tree;
+    const FunctionSet& fs = TestFS::treeEval();
+    std::string source = "Mult(AddFloat(0.5, Sqrt(4)), AddInt(1, Floor(2.5)))";
+    GpTreeParser::parse(fs, source, gp_tree);
+    std::string indented = ("Mult(AddFloat(0.5,\n"
+                            "              Sqrt(4)),\n"
+                            "     AddInt(1,\n"
+                            "            Floor(2.5)))");
+    std::string prefixed = ("//Mult(AddFloat(0.5,\n"
+                            "//              Sqrt(4)),\n"
+                            "//     AddInt(1,\n"
+                            "//            Floor(2.5)))");
+    ok = ok && st(gp_tree.to_string() == source);
+    ok = ok && st(gp_tree.to_string(true) == indented);
+    ok = ok && st(gp_tree.to_string(true, "//") == prefixed);
+    // Versions writing to a reusable string buffer and to an output stream.
+    std::string buffer = "old contents";
+    buffer.clear();
+    gp_tree.to_string(buffer, true);
+    ok = ok && st(buffer == indented);
+    gp_tree.to_string(buffer, false, " ");
+    ok = ok && st(buffer == indented + " " + source);
+    std::stringstream stream;
+    gp_tree.to_string(stream, true, "//");
+    ok = ok && st(stream.str() == prefixed);
+    return ok;
+}
+
+bool population_instrumentation()
+{
+    bool ok = true;
+    int steps = 50;
+    LPRS().setSeed(17404261);
+    Population p(30, 2, 20, TestFS::treeEval());
+    p.setLoggerFunction([](Population&){});  // Do nothing logger.
+    auto fitness = [](Individual* i){ return i->tree().size(); };
+    // Run with instrumentation disabled (default) then enabled.
+    for (int i = 0; i < steps; i++) { p.evolutionStep(fitness); }
+    Instrumentation::Report before = p.instrumentation().snapshot();
+    p.instrumentation().setEnabled(true);
+    p.instrumentation().setTraceEventLimit(1000);
+    for (int i = 0; i < steps; i++) { p.evolutionStep(fitness); }
+    Instrumentation::Report after = p.instrumentation().snapshot();
+    for (int phase = 0; phase < Instrumentation::PhaseCount; phase++)
+    {
+        ok = ok && st(before[phase].count == 0);
+    }
+    for (auto phase : {Instrumentation::TournamentSelection,
+                       Instrumentation::TournamentFunction,
+                       Instrumentation::Crossover,
+                       Instrumentation::TreeEvaluation,
+                       Instrumentation::Migration,
+                       Instrumentation::Logging})
+    {
+        ok = ok && st(int(after[phase].count) == steps);
+    }
+    const auto& tf = after[Instrumentation::TournamentFunction];
+    ok = ok && st(tf.min_ns <= tf.max_ns);
+    ok = ok && st(tf.quantileNs(0.5) <= tf.max_ns);
+    // Write CSV and Chrome trace files, verify they have expected sizes.
+    std::string csv = "/tmp/lazy_predator_unit_test_phases.csv";
+    std::string trace = "/tmp/lazy_predator_unit_test_trace.json";
+    ok = ok && st(p.instrumentation().writeCSV(csv));
+    ok = ok && st(p.instrumentation().writeChromeTrace(trace));
+    auto count_lines = [](std::string pathname)
+    {
+        std::ifstream stream(pathname);
+        return std::count(std::istreambuf_iterator<char>(stream),
+                          std::istreambuf_iterator<char>(), '\n');
+    };
+    ok = ok && st(count_lines(csv) == 1 + Instrumentation::PhaseCount);
+    ok = ok && st(count_lines(trace) > 6 * steps);
+    std::remove(csv.c_str());
+    std::remove(trace.c_str());
+    // After reset(), all counts should be zero.
+    p.instrumentation().reset();
+    Instrumentation::Report reset = p.instrumentation().snapshot();
+    ok = ok && st(reset[Instrumentation::Crossover].count == 0);
+    // A thread's index (which keys its per-thread data) is reused after it
+    // exits, so short lived threads do not accumulate data.
+    auto index_on_new_thread = []()
+    {
+        int index = -1;
+        std::thread([&](){ index = ThreadIndex::current(); }).join();
+        return index;
+    };
+    int index = index_on_new_thread();
+    ok = ok && st(index != ThreadIndex::current());
+    ok = ok && st(index_on_new_thread() == index);
+    return ok;
+}
+
+bool gp_function_profiler()
+{
+    bool ok = true;
+    int n = 100;
+    const FunctionSet& fs = TestFS::treeEval();
+    GpTree gp_tree;
+    GpTreeParser::parse(fs, "Mult(AddFloat(AddFloat(0.5, Sqrt(4)), 1), "
+                        "AddInt(1, Floor(2.5)))", gp_tree);
+    // Not recorded when disabled (default).
+    GpFunctionProfiler::reset();
+    gp_tree.eval();
+    ok = ok && st(GpFunctionProfiler::report().empty());
+    GpFunctionProfiler::setEnabled(true);
+    for (int i = 0; i < n; i++) { gp_tree.eval(); }
+    GpFunctionProfiler::setEnabled(false);
+    typedef GpFunctionProfiler::Stats Stats;
+    std::vector<Stats> report = GpFunctionProfiler::report();
+    std::map<std::string, Stats> stats;
+    for (auto& s : report) { stats[s.name] = s; }
+    ok = ok && st(report.size() == 5);
+    ok = ok && st(report.front().name == "Mult");
+    ok = ok && st(int(stats["Mult"].calls) == n);
+    ok = ok && st(int(stats["AddFloat"].calls) == 2 * n);
+    ok = ok && st(int(stats["Sqrt"].calls) == n);
+    ok = ok && st(int(stats["Floor"].calls) == n);
+    for (auto& s : report) { ok = ok && st(s.self_ns <= s.total_ns); }
+    // Inclusive time of recursive AddFloat is counted once per outer call.
+    ok = ok && st(stats["AddFloat"].total_ns < stats["Mult"].total_ns);
+    ok = ok && st(stats["AddFloat"].total_ns >= stats["Sqrt"].total_ns);
+    for (size_t i = 1; i < report.size(); i++)
+    {
+        ok = ok && st(report[i - 1].total_ns >= report[i].total_ns);
+    }
+    GpFunctionProfiler::reset();
+    ok = ok && st(GpFunctionProfiler::report().empty());
+    return ok;
+}
+
+bool gp_tree_cost_budget()
+{
+    bool ok = true;
+    LPRS().setSeed(72801369);
+    auto eval_zero = [](GpTree&) { return std::any(0); };
+    // "Big" costs 100 per call, the others 1.
+    FunctionSet fs = { { { "Int", 0, 9 } },
+                       { { "P", "Int", {"Int"}, eval_zero },
+                         { "PP", "Int", {"Int", "Int"}, eval_zero },
+                         { "Big", "Int", {"Int", "Int"}, eval_zero, 1, 100 },
+                       }, };
+    const FunctionSet& const_fs = fs;
+    const GpType& int_type = *const_fs.lookupGpTypeByName("Int");
+    const GpFunction& big = *const_fs.lookupGpFunctionByName("Big");
+    ok = ok && st(int_type.minCostToTerminate() == 0);
+    ok = ok && st(big.minCostToTerminate() == 100);
+    // Random trees respect cost budget, so never contain "Big".
+    float max_cost = 10;
+    for (int i = 0; i < 100; i++)
+    {
+        GpTree gp_tree;
+        fs.makeRandomTree(50, max_cost, gp_tree);
+        ok = ok && st(gp_tree.cost() <= max_cost);
+        ok = ok && st(gp_tree.to_string().find("Big") == std::string::npos);
+    }
+    // Unlimited cost budget produces same trees as before (same RNG usage).
+    GpTree a, b;
+    LPRS().setSeed(12345);
+    fs.makeRandomTree(50, a);
+    LPRS().setSeed(12345);
+    fs.makeRandomTree(50, std::numeric_limits<float>::infinity(), b);
+    ok = ok && st(a.to_string() == b.to_string());
+    ok = ok && st(a.cost() >= 100);
+    // Crossover with cost budget produces cheaper offspring than without.
+    // Retries for a cheaper offspring still respect size limits.
+    float cost_limited = 0;
+    float cost_unlimited = 0;
+    int out_of_range_limited = 0;
+    int out_of_range_unlimited = 0;
+    auto out_of_range = [](const GpTree& t)
+        { return (t.size() < 25) || (t.size() > 75); };
+    for (int i = 0; i < 100; i++)
+    {
+        GpTree p0, p1, offspring;
+        fs.makeRandomTree(50, p0);
+        fs.makeRandomTree(50, p1);
+        GpTree::crossover(p0, p1, offspring, 25, 75, 1);
+        cost_unlimited += offspring.cost();
+        out_of_range_unlimited += out_of_range(offspring);
+        GpTree::crossover(p0, p1, offspring, 25, 75, 1, max_cost);
+        cost_limited += offspring.cost();
+        out_of_range_limited += out_of_range(offspring);
+    }
+    ok = ok && st(cost_limited < cost_unlimited);
+    ok = ok && st(out_of_range_limited <= out_of_range_unlimited);
+    // Learn costs from profile of evaluation.
+    GpFunctionProfiler::reset();
+    GpFunctionProfiler::setEnabled(true);
+    for (int i = 0; i < 100; i++) { a.eval(); }
+    GpFunctionProfiler::setEnabled(false);
+    fs.learnEvalCosts();
+    // Costs are relative to the cheapest profiled GpFunction, whose cost is
+    // 1 like that of GpFunctions not profiled.
+    float unit = std::numeric_limits<float>::infinity();
+    for (auto& stats : GpFunctionProfiler::report())
+    {
+        float ns = float(stats.self_ns) / stats.calls;
+        if (ns > 0) { unit = std::min(unit, ns); }
+    }
+    float cheapest = std::numeric_limits<float>::infinity();
+    for (auto& stats : GpFunctionProfiler::report())
+    {
+        float ns = float(stats.self_ns) / stats.calls;
+        auto function = const_fs.lookupGpFunctionByName(stats.name);
+        ok = ok && st(function->evalCost() == std::max(ns, unit) / unit);
+        cheapest = std::min(cheapest, function->evalCost());
+    }
+    ok = ok && st(cheapest == 1);
+    GpFunctionProfiler::reset();
+    fs.setEvalCost("Big", 100);
+    ok = ok && st(big.evalCost() == 100);
+    return ok;
+}
+
+bool population_bloat_control()
+{
+    bool ok = true;
+    int steps = 500;
+    // Run Population with given BloatControl, with all fitnesses equal.
+    auto run = [&](BloatControl bloat_control)
+    {
+        LPRS().setSeed(28660471);
+        auto p = std::make_unique<Population>(100, 2, 30, TestFS::treeEval(),
+                                              bloat_control);
+        p->setLoggerFunction([](Population&){});
+        for (int i = 0; i < steps; i++)
+        {
+            p->evolutionStep([](Individual*){ return 0.0f; });
+        }
+        return p;
+    };
+    auto none = run(BloatControl::None);
+    const BloatControl::Stats& none_stats = none->bloatControl().stats();
+    ok = ok && st(int(none_stats.offspring) == steps);
+    ok = ok && st(none_stats.rejections == 0);
+    // Size and depth limits apply to every tree.
+    BloatControl limit(BloatControl::SizeDepthLimit);
+    limit.setMaxSize(30);
+    limit.setMaxDepth(12);
+    auto size_depth = run(limit);
+    ok = ok && st(size_depth->bloatControl().stats().offspring == uint64_t(steps));
+    size_depth->applyToAllIndividuals([&](Individual* i)
+    {
+        ok = ok && st(i->tree().size() <= 30);
+    });
+    // With fitness ties, parsimony and Tarpeian reduce average tree size.
+    auto parsimony = run(BloatControl::LexicographicParsimony);
+    auto tarpeian = run(BloatControl::Tarpeian);
+    ok = ok && st(parsimony->bloatControl().stats().parsimony_decisions > 0);
+    ok = ok && st(tarpeian->bloatControl().stats().tarpeian_removals > 0);
+    ok = ok && st(parsimony->averageTreeSize() < none->averageTreeSize());
+    ok = ok && st(tarpeian->averageTreeSize() < none->averageTreeSize());
+    // Operator equalisation rejects some offspring, but accepts one per step.
+    auto equalisation = run(BloatControl::OperatorEqualisation);
+    const BloatControl::Stats& eq_stats = equalisation->bloatControl().stats();
+    ok = ok && st(eq_stats.rejections > 0);
+    ok = ok && st(int(eq_stats.offspring) == steps);
+    return ok;
+}
+
+bool function_set_ids()
+{
+    bool ok = true;
+    LPRS().setSeed(50216487);
+    const FunctionSet& fs = TestFS::treeEval();
+    // IDs are dense, in order of name, and index the FunctionSet's storage.
+    ok = ok && st(fs.gpTypes().size() == 2);
+    ok = ok && st(fs.gpFunctions().size() == 5);
+    for (int i = 0; i < int(fs.gpTypes().size()); i++)
+    {
+        const GpType& gp_type = fs.gpTypes().at(i);
+        ok = ok && st(gp_type.id() == i);
+        ok = ok && st(&fs.gpTypeById(i) == &gp_type);
+        ok = ok && st(fs.lookupGpTypeByName(gp_type.name()) == &gp_type);
+    }
+    for (int i = 0; i < int(fs.gpFunctions().size()); i++)
+    {
+        const GpFunction& gp_function = fs.gpFunctions().at(i);
+        ok = ok && st(gp_function.id() == i);
+        ok = ok && st(&fs.gpFunctionById(i) == &gp_function);
+        ok = ok && st(fs.findGpFunctionByName(gp_function.name()) ==
+                      &gp_function);
+    }
+    ok = ok && st(fs.gpFunctions().front().name() == "AddFloat");
+    ok = ok && st(fs.findGpFunctionByName("Nonexistent") == nullptr);
+    ok = ok && st(fs.findGpTypeByName("Nonexistent") == nullptr);
+    // GpTypeSet agrees with std::set version of shared types.
+    const GpType* float_type = fs.lookupGpTypeByName("Float");
+    const GpType* int_type = fs.lookupGpTypeByName("Int");
+    GpTypeSet floats = { float_type };
+    GpTypeSet both = { float_type, int_type };
+    ok = ok && st((floats & both) == floats);
+    ok = ok && st(both.size() == 2);
+    ok = ok && st(floats.contains(float_type) && !floats.contains(int_type));
+    for (int i = 0; i < 20; i++)
+    {
+        GpTree a, b;
+        fs.makeRandomTree(LPRS().random2(1, 20), a);
+        fs.makeRandomTree(LPRS().random2(1, 20), b);
+        GpTypeSet shared_bits;
+        std::set<const GpType*> shared_set;
+        GpTree::sharedSetOfTypes(a, b, shared_bits);
+        GpTree::sharedSetOfTypes(a, b, shared_set);
+        ok = ok && st(shared_bits.size() == shared_set.size());
+        for (auto t : shared_set) { ok = ok && st(shared_bits.contains(t)); }
+    }
+    // GpTypes without IDs, or with IDs past GpTypeSet::max_types, also work.
+    GpType unregistered("Unregistered");
+    GpTypeSet mixed = { float_type, &unregistered };
+    ok = ok && st(mixed.size() == 2 && mixed.contains(&unregistered));
+    ok = ok && st((mixed & both) == floats);
+    ok = ok && st((mixed | both).size() == 3);
+    std::vector<GpType> many_types;
+    for (int i = 0; i < GpTypeSet::max_types + 10; i++)
+    {
+        many_types.push_back(GpType("T" + std::to_string(1000 + i)));
+    }
+    FunctionSet many(many_types, {});
+    const GpType* last = &many.gpTypes().back();
+    ok = ok && st(last->id() >= GpTypeSet::max_types);
+    GpTypeSet big = { last, &many.gpTypes().front() };
+    ok = ok && st(big.contains(last) && (big.size() == 2));
+    // Deprecated name-to-object map interface, in name order.
+    auto function_map = fs.nameToGpFunctionMap();
+    ok = ok && st(function_map.size() == fs.gpFunctions().size());
+    ok = ok && st(&function_map.at("AddInt") ==
+                  fs.lookupGpFunctionByName("AddInt"));
+    ok = ok && st(function_map.count("Nonexistent") == 0);
+    std::string previous;
+    for (auto& [name, gp_function] : function_map)
+    {
+        ok = ok && st((name == gp_function.name()) && (previous < name));
+        previous = name;
+    }
+    // Deprecated addGpFunction() rebuilds, keeping settings and root type.
+    auto eval_zero = [](GpTree&) { return std::any(0); };
+    FunctionSet added({ { "Int", 0, 9 }, { "Bool" } },
+                      { { "P", "Int", {"Int"}, eval_zero } });
+    added.setEvalCost("P", 5);
+    GpFunction q("Q", "Int", {"Int", "Int"}, eval_zero);
+    added.addGpFunction(q);
+    const GpType* added_int = added.findGpTypeByName("Int");
+    ok = ok && st(added.gpFunctions().size() == 2);
+    ok = ok && st(added_int->functionsReturningThisType().size() == 2);
+    ok = ok && st(added.getRootType() == added_int);
+    ok = ok && st(added.findGpFunctionByName("P")->evalCost() == 5);
+    ok = ok && st(added.findGpFunctionByName("Q")->minSizeToTerminate() == 3);
+    GpTree added_tree;
+    added.makeRandomTree(10, added_tree);
+    ok = ok && st(added_tree.size() <= 10);
+    return ok;
+}
+
+bool eval_plan()
+{
+    bool ok = true;
+    // FunctionSet like TestFS::treeEval() plus "Input" and "Var" which read a
+    // varying fitness case value, and impure "Noise". Counts calls to
+    // AddFloat.
+    float input = 0;
+    int add_float_calls = 0;
+    FunctionSet fs =
+    {
+        { { "Float", 0.0f, 1.0f }, { "Int", 0, 9 } },
+        {
+            {
+                "AddInt", "Int", {"Int", "Int"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<int>(0) +
+                                    t.evalSubtree<int>(1));
+                }
+            },
+            {
+                "AddFloat", "Float", {"Float", "Float"}, [&](GpTree& t)
+                {
+                    add_float_calls++;
+                    return std::any(t.evalSubtree<float>(0) +
+                                    t.evalSubtree<float>(1));
+                }
+            },
+            {
+                "Floor", "Int", {"Float"}, [](GpTree& t)
+                {
+                    return std::any(int(std::floor(t.evalSubtree<float>(0))));
+                }
+            },
+            {
+                "Sqrt", "Float", {"Int"}, [](GpTree& t)
+                {
+                    return std::any(float(std::sqrt(t.evalSubtree<int>(0))));
+                }
+            },
+            {
+                "Mult", "Float", {"Float", "Int"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<float>(0) *
+                                    t.evalSubtree<int>(1));
+                }
+            },
+            {
+                "Input", "Float", {}, [&](GpTree&) { return std::any(input); }
+            },
+            {
+                "Var", "Float", {"Int"}, [&](GpTree& t)
+                {
+                    return std::any(input * t.evalSubtree<int>(0));
+                }
+            },
+            {
+                "Noise", "Float", {}, [](GpTree&)
+                {
+                    return std::any(LPRS().random2(0.0f, 0.001f));
+                }
+            }
+        }
+    };
+    for (auto name : {"AddInt", "AddFloat", "Floor", "Sqrt", "Mult", "Input",
+                      "Var"})
+    {
+        fs.setPure(name, true);
+    }
+    for (auto name : {"AddInt", "AddFloat", "Floor", "Sqrt", "Mult"})
+    {
+        fs.setFoldable(name, true);
+    }
+    GpTree gp_tree;
+    GpTreeParser::parse(fs, "Mult(AddFloat(AddFloat(Input(), Sqrt(4)), "
+                        "AddFloat(Input(), Sqrt(4))), AddInt(3, Floor(0.4)))",
+                        gp_tree);
+    EvalPlan plan(gp_tree);
+    // Sqrt(4) and AddInt(3, Floor(0.4)) fold, AddFloat(Input(), 2) merges.
+    ok = ok && st(plan.treeSize() == gp_tree.size());
+    ok = ok && st(plan.foldedCount() == 4);
+    ok = ok && st(plan.mergedCount() == 2);
+    ok = ok && st(plan.executionCount() == 4);
+    for (float i : {0.0f, 0.25f, 0.5f, 1.0f})
+    {
+        input = i;
+        add_float_calls = 0;
+        float expected = std::any_cast<float>(gp_tree.eval());
+        ok = ok && st(add_float_calls == 3);
+        add_float_calls = 0;
+        ok = ok && st(std::any_cast<float>(plan.eval()) == expected);
+        ok = ok && st(add_float_calls == 2);
+    }
+    // Impure subtrees are neither folded nor merged.
+    GpTree noise_tree;
+    GpTreeParser::parse(fs, "AddFloat(AddFloat(Noise(), 0.5), "
+                        "AddFloat(Noise(), 0.5))", noise_tree);
+    EvalPlan impure_plan(noise_tree);
+    ok = ok && st(impure_plan.foldedCount() == 0);
+    ok = ok && st(impure_plan.mergedCount() == 0);
+    ok = ok && st(impure_plan.executionCount() == 5);
+    // Var(3) reads the fitness case: merged but not folded.
+    GpTree var_tree;
+    GpTreeParser::parse(fs, "AddFloat(Var(AddInt(1, 2)), Var(3))", var_tree);
+    EvalPlan var_plan(var_tree);
+    ok = ok && st(var_plan.foldedCount() == 1);
+    ok = ok && st(var_plan.mergedCount() == 1);
+    ok = ok && st(var_plan.executionCount() == 2);
+    for (float i : {0.0f, 0.5f, 1.0f})
+    {
+        input = i;
+        ok = ok && st(std::any_cast<float>(var_plan.eval()) == i * 6);
+    }
+    // Nothing is optimized when no function is pure.
+    for (auto& function : fs.gpFunctions())
+    {
+        fs.setPure(function.name(), false);
+        fs.setFoldable(function.name(), false);
+    }
+    GpTree constant_tree;
+    GpTreeParser::parse(fs, "Mult(0.5, AddInt(3, Floor(0.4)))", constant_tree);
+    EvalPlan unoptimized_plan(constant_tree);
+    ok = ok && st(unoptimized_plan.foldedCount() == 0);
+    ok = ok && st(unoptimized_plan.executionCount() == 3);
+    ok = ok && st(std::any_cast<float>(unoptimized_plan.eval()) == 1.5);
+    // Folded values with a deleter are deleted once, including by move
+    // assignment, which deletes those of the plan assigned to.
+    int live_boxes = 0;
+    FunctionSet box_fs =
+    {
+        {
+            { "Box", [&](std::any a)
+                { delete std::any_cast<int*>(a); live_boxes--; } },
+            { "Int", 0, 9 }
+        },
+        {
+            {
+                "MakeBox", "Box", {"Int"}, [&](GpTree& t)
+                {
+                    live_boxes++;
+                    return std::any(new int(t.evalSubtree<int>(0)));
+                }
+            }
+        }
+    };
+    box_fs.setPure("MakeBox", true);
+    box_fs.setFoldable("MakeBox", true);
+    GpTree box3, box4;
+    ok = ok && st(GpTreeParser::parse(box_fs, "MakeBox(3)", box3));
+    ok = ok && st(GpTreeParser::parse(box_fs, "MakeBox(4)", box4));
+    {
+        EvalPlan a(box3);
+        EvalPlan b(box4);
+        ok = ok && st(live_boxes == 2);
+        a = std::move(b);
+        ok = ok && st(live_boxes == 1);
+        ok = ok && st(*std::any_cast<int*>(a.eval()) == 4);
+    }
+    ok = ok && st(live_boxes == 0);
+    return ok;
+}
+
+bool native_code()
+{
+    bool ok = true;
+    LPRS().setSeed(40711852);
+    // FunctionSet like TestFS::treeEval() plus "Input" which reads a fitness
+    // case value via "context".
+    float input = 0;
+    FunctionSet fs =
+    {
+        { { "Float", 0.0f, 1.0f }, { "Int", 0, 9 } },
+        {
+            {
+                "AddInt", "Int", {"Int", "Int"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<int>(0) +
+                                    t.evalSubtree<int>(1));
+                }
+            },
+            {
+                "AddFloat", "Float", {"Float", "Float"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<float>(0) +
+                                    t.evalSubtree<float>(1));
+                }
+            },
+            {
+                "Floor", "Int", {"Float"}, [](GpTree& t)
+                {
+                    return std::any(int(std::floor(t.evalSubtree<float>(0))));
+                }
+            },
+            {
+                "Sqrt", "Float", {"Int"}, [](GpTree& t)
+                {
+                    return std::any(float(std::sqrt(t.evalSubtree<int>(0))));
+                }
+            },
+            {
+                "Mult", "Float", {"Float", "Int"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<float>(0) *
+                                    t.evalSubtree<int>(1));
+                }
+            },
+            {
+                "Input", "Float", {}, [&](GpTree&) { return std::any(input); }
+            }
+        }
+    };
+    fs.setCodeTemplate("AddInt", "$0 + $1");
+    fs.setCodeTemplate("AddFloat", "$0 + $1");
+    fs.setCodeTemplate("Floor", "int(std::floor($0))");
+    fs.setCodeTemplate("Sqrt", "float(std::sqrt($0))");
+    fs.setCodeTemplate("Mult", "$0 * $1");
+    NativeCompiler compiler;
+    compiler.setPrelude("#include <cmath>");
+    GpTree gp_tree;
+    GpTreeParser::parse(fs, "Mult(AddFloat(Input(), Sqrt(4)), "
+                        "AddInt(3, Floor(0.4)))", gp_tree);
+    // Fails (with message) when a GpFunction has no code template.
+    ok = ok && st(!compiler.compile(gp_tree));
+    ok = ok && st(compiler.errorMessage().find("Input") != std::string::npos);
+    fs.setCodeTemplate("Input", "*static_cast<const float*>(context)");
+    std::string source = compiler.generateSource(gp_tree);
+    ok = ok && st(source.find("native_eval") != std::string::npos);
+    // Compiling requires a C++ compiler at run time.
+    if (std::system("c++ --version > /dev/null 2>&1") != 0) { return ok; }
+    // (Cache directory name needs quoting for the shell.)
+    compiler.setCacheDirectory((std::filesystem::temp_directory_path() /
+                                "lazy_predator native'test").string());
+    std::filesystem::remove_all(compiler.cacheDirectory());
+    auto program = compiler.compile(gp_tree);
+    ok = ok && st(program != nullptr);
+    ok = ok && st(compiler.compilations() == 1);
+    for (float i : {0.0f, 0.25f, 0.5f, 1.0f})
+    {
+        input = i;
+        ok = ok && st(program->eval<float>(&input) ==
+                      std::any_cast<float>(gp_tree.eval()));
+    }
+    // Native version of random trees matches, cache hit on recompile.
+    Individual individual(30, fs);
+    ok = ok && st(compiler.compile(individual));
+    input = 0.3;
+    ok = ok && st(individual.nativeProgram()->eval<float>(&input) ==
+                  std::any_cast<float>(individual.treeValue()));
+    ok = ok && st(compiler.compile(individual.tree()) ==
+                  individual.nativeProgram());
+    ok = ok && st(compiler.cacheHits() == 1);
+    // A new compiler reuses library from the on-disk cache.
+    NativeCompiler compiler2;
+    compiler2.setPrelude(compiler.prelude());
+    compiler2.setCacheDirectory(compiler.cacheDirectory());
+    ok = ok && st(compiler2.compile(gp_tree) != nullptr);
+    ok = ok && st(compiler2.compilations() == 0);
+    // A cached library whose stored source differs is rebuilt.
+    for (auto& entry : std::filesystem::directory_iterator
+                           (compiler.cacheDirectory()))
+    {
+        if (entry.path().extension() == ".cpp")
+        {
+            std::ofstream(entry.path()) << "// changed" << std::endl;
+        }
+    }
+    NativeCompiler compiler3;
+    compiler3.setPrelude(compiler.prelude());
+    compiler3.setCacheDirectory(compiler.cacheDirectory());
+    ok = ok && st(compiler3.compile(gp_tree) != nullptr);
+    ok = ok && st(compiler3.compilations() == 1);
+    // A cache directory others can write to is refused.
+    std::filesystem::permissions(compiler.cacheDirectory(),
+                                 std::filesystem::perms::all);
+    compiler3.clearCache();
+    ok = ok && st(!compiler3.compile(gp_tree));
+    ok = ok && st(compiler3.errorMessage().find("0700") != std::string::npos);
+    // A compile error is reported.
+    fs.setCodeTemplate("Mult", "$0 * * $1");
+    ok = ok && st(!compiler.compile(gp_tree));
+    ok = ok && st(!compiler.errorMessage().empty());
+    std::filesystem::remove_all(compiler.cacheDirectory());
+    return ok;
+}
+
+bool eval_workers()
+{
+    bool ok = true;
+    LPRS().setSeed(58102277);
+    const FunctionSet& fs = TestFS::treeEval();
+    std::vector<GpTree> trees(20);
+    std::vector<const GpTree*> pointers;
+    for (auto& tree : trees)
+    {
+        fs.makeRandomTree(40, tree);
+        pointers.push_back(&tree);
+    }
+    auto value = [](const GpTree& tree)
+    {
+        GpTree copy = tree;
+        return std::any_cast<float>(copy.eval());
+    };
+    // Fitness in workers matches fitness in this process. Worker crashes (here
+    // simulated by SIGKILL) fail only that evaluation.
+    float threshold = value(trees.front());
+    EvalWorkers workers(fs, 3, [&](GpTree& tree)
+    {
+        float fitness = std::any_cast<float>(tree.eval());
+        if (fitness == threshold) { raise(SIGKILL); }
+        return fitness;
+    });
+    std::vector<float> fitnesses = workers.fitness(pointers);
+    int expected_crashes = 0;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+        float expected = value(trees.at(i));
+        if (expected == threshold)
+        {
+            expected_crashes++;
+            expected = workers.failureMetric();
+        }
+        ok = ok && st(fitnesses.at(i) == expected);
+    }
+    ok = ok && st(expected_crashes > 0);
+    ok = ok && st(workers.crashes() == expected_crashes);
+    ok = ok && st(workers.evaluations() == int(trees.size()) - expected_crashes);
+    // Replacement workers still run, and are used by a TournamentFunction.
+    Population population(30, 1, 40, fs);
+    population.setLoggerFunction([](Population&){});
+    population.run(30, workers.tournamentFunction(population));
+    ok = ok && st(population.getStepCount() == 30);
+    ok = ok && st(workers.evaluations() > int(trees.size()));
+    // Group function: metric is rank by value within group.
+    EvalWorkers ranker(fs, 2, [](std::vector<GpTree>& group)
+    {
+        std::vector<float> metrics;
+        for (auto& tree : group)
+        {
+            float rank = 0;
+            float v = std::any_cast<float>(tree.eval());
+            for (auto& other : group)
+            {
+                if (std::any_cast<float>(other.eval()) < v) { rank++; }
+            }
+            metrics.push_back(rank);
+        }
+        return metrics;
+    });
+    auto results = ranker.evaluate({{&trees.at(1), &trees.at(2)},
+                                    {&trees.at(3), &trees.at(4),
+                                     &trees.at(5)}});
+    ok = ok && st(results.size() == 2);
+    ok = ok && st(results.at(0).ok && results.at(1).ok);
+    ok = ok && st(results.at(1).metrics.size() == 3);
+    ok = ok && st((results.at(0).metrics.at(0) == 1) ==
+                  (value(trees.at(1)) > value(trees.at(2))));
+    // An exception thrown in a worker is a crash.
+    EvalWorkers thrower(fs, 1, [](GpTree&) -> float
+    {
+        throw std::runtime_error("test");
+    });
+    results = thrower.evaluate({{&trees.at(0)}});
+    ok = ok && st(!results.at(0).ok && results.at(0).crashed);
+    ok = ok && st(thrower.crashes() == 1);
+    // A worker which dies while idle is replaced before its next job, and
+    // counted as a crash.
+    EvalWorkers doomed(fs, 1, [](GpTree& tree)
+    {
+        std::thread([](){ usleep(20000); raise(SIGKILL); }).detach();
+        return std::any_cast<float>(tree.eval());
+    });
+    results = doomed.evaluate({{&trees.at(0)}});
+    ok = ok && st(results.at(0).ok && (doomed.crashes() == 0));
+    usleep(200000);
+    results = doomed.evaluate({{&trees.at(1)}});
+    ok = ok && st(results.at(0).ok && (doomed.crashes() == 1));
+    // A job, or response, too large for a ring is an error, not a crash.
+    GpTree small_tree;
+    GpTreeParser::parse(fs, "Sqrt(4)", small_tree);
+    EvalWorkers small_rings(fs, 1, [](std::vector<GpTree>&)
+    {
+        return std::vector<float>(100, 0.0f);
+    }, 128);
+    results = small_rings.evaluate({{&trees.at(0)}, {&small_tree}});
+    ok = ok && st(!results.at(0).ok && !results.at(0).crashed);
+    ok = ok && st(results.at(0).error == "job too large for ring");
+    ok = ok && st(!results.at(1).ok && !results.at(1).crashed);
+    ok = ok && st(results.at(1).error == "response too large for ring");
+    ok = ok && st(small_rings.crashes() == 0);
+    bool thrown = false;
+    try { small_rings.fitness({&trees.at(0)}); }
+    catch (const std::runtime_error&) { thrown = true; }
+    ok = ok && st(thrown);
+    return ok;
+}
+
+bool eval_budget()
+{
+    bool ok = true;
+    LPRS().setSeed(23901475);
+    // Node budget: stops evaluation of trees with too many function nodes.
+    const FunctionSet& fs = TestFS::treeEval();
+    GpTree small;
+    GpTree large;
+    GpTreeParser::parse(fs, "AddFloat(0.5, Sqrt(4))", small);
+    GpTreeParser::parse(fs, "AddFloat(AddFloat(AddFloat(0.5, Sqrt(4)), 0.1), "
+                        "AddFloat(0.5, Sqrt(4)))", large);
+    EvalBudget budget(4, 0);
+    ok = ok && st(budget.run([&](){ small.eval(); }));
+    ok = ok && st(budget.nodes() == 2);
+    ok = ok && st(!budget.run([&](){ large.eval(); }));
+    ok = ok && st(budget.nodes() == 5);
+    ok = ok && st(budget.stoppedCount() == 1);
+    // No budget is current outside run().
+    ok = ok && st(EvalBudget::current() == nullptr);
+    // A GpFunction polls shouldStop(), stops for time limit or cancel().
+    FunctionSet spin_fs =
+    {
+        { { "Float", 0.0f, 1.0f } },
+        {
+            {
+                "AddFloat", "Float", {"Float", "Float"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<float>(0) +
+                                    t.evalSubtree<float>(1));
+                }
+            },
+            {
+                "Spin", "Float", {}, [](GpTree&)
+                {
+                    while (!EvalBudget::shouldStop()) {}
+                    return std::any(0.0f);
+                }
+            },
+            {
+                "Slow", "Float", {}, [](GpTree&)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    return std::any(0.0f);
+                }
+            }
+        }
+    };
+    GpTree spin;
+    GpTreeParser::parse(spin_fs, "AddFloat(Spin(), 0.5)", spin);
+    EvalBudget timed(0, 0.01);
+    ok = ok && st(!timed.run([&](){ spin.eval(); }));
+    ok = ok && st(timed.seconds() >= 0.01);
+    EvalBudget cancelable(0, 100);
+    std::thread canceler([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        cancelable.cancel();
+    });
+    ok = ok && st(!cancelable.run([&](){ spin.eval(); }));
+    canceler.join();
+    ok = ok && st(cancelable.cancelled());
+    // Time is checked before each node, so slow nodes which do not poll
+    // shouldStop() overshoot the limit by at most one node.
+    GpTree slow;
+    GpTreeParser::parse(spin_fs, "AddFloat(Slow(), AddFloat(Slow(), "
+                        "AddFloat(Slow(), Slow())))", slow);
+    ok = ok && st(!timed.run([&](){ slow.eval(); }));
+    ok = ok && st(timed.nodes() == 3);
+    // Other exceptions pass through run(), which restores the current budget.
+    bool thrown = false;
+    try { timed.run([](){ throw std::runtime_error("test"); }); }
+    catch (const std::runtime_error&) { thrown = true; }
+    ok = ok && st(thrown && (EvalBudget::current() == nullptr));
+    // In a Population, over budget Individuals lose (WorstFitness policy) or
+    // their tournaments are canceled (InvalidTournament policy).
+    auto fitness = [](Individual* i)
+        { return std::any_cast<float>(i->treeValue()); };
+    for (auto policy : {EvalBudget::WorstFitness,
+                        EvalBudget::InvalidTournament})
+    {
+        Population population(50, 1, 40, fs);
+        population.setLoggerFunction([](Population&){});
+        population.setEvalBudget(EvalBudget(8, 0, policy));
+        for (int i = 0; i < 200; i++) { population.evolutionStep(fitness); }
+        ok = ok && st(population.getStepCount() == 200);
+        ok = ok && st(population.getOverBudgetCount() > 0);
+        int over_budget = 0;
+        population.applyToAllIndividuals([&](Individual* i)
+                                         { over_budget += i->overBudget(); });
+        if (policy == EvalBudget::InvalidTournament)
+        {
+            ok = ok && st(over_budget == 0);
+        }
+    }
+    // Cancel a Population's evaluation in progress from another thread.
+    Population population(20, 1, 20, fs);
+    population.setLoggerFunction([](Population&){});
+    population.setEvalBudget(EvalBudget(0, 100));
+    std::atomic<bool> spinning = false;
+    std::thread population_canceler([&]()
+    {
+        while (!spinning) { std::this_thread::yield(); }
+        population.evalBudget().cancel();
+    });
+    population.evolutionStep([&](Individual* i)
+    {
+        if (!spinning.exchange(true)) { spin.eval(); }
+        return std::any_cast<float>(i->treeValue());
+    });
+    population_canceler.join();
+    // (Stops both the fitness function and the tournament containing it.)
+    int cancelled_count = population.getOverBudgetCount();
+    ok = ok && st(cancelled_count > 0);
+    // Later evaluations are not affected.
+    population.evolutionStep(fitness);
+    ok = ok && st(population.getOverBudgetCount() == cancelled_count);
+    ok = ok && st(population.getStepCount() == 2);
+    return ok;
+}
+
+bool racing()
+{
+    bool ok = true;
+    LPRS().setSeed(81725034);
+    const FunctionSet& fs = TestFS::treeEval();
+    // Per-case fitness: a value per Individual (from its tree) plus per-case
+    // noise, clipped to [0, 1].
+    int cases = 1000;
+    std::vector<float> noise;
+    for (int c = 0; c < cases; c++)
+    {
+        noise.push_back(LPRS().random2(-0.2f, 0.2f));
+    }
+    auto case_fitness = [&](Individual* individual, int c)
+    {
+        float value = std::any_cast<float>(individual->treeValue());
+        float base = value / (1 + std::abs(value));
+        return std::clamp(base + noise[c], 0.0f, 1.0f);
+    };
+    auto full_fitness = [&](Individual* individual)
+    {
+        float sum = 0;
+        for (int c = 0; c < cases; c++) { sum += case_fitness(individual, c); }
+        return sum / cases;
+    };
+    Racing deterministic(cases, case_fitness, 0, 1, Racing::Deterministic);
+    Racing statistical(cases, case_fitness, 0, 1, Racing::Statistical);
+    Population population(60, 1, 40, fs);
+    int statistical_agree = 0;
+    int tournaments = 100;
+    for (int t = 0; t < tournaments; t++)
+    {
+        std::vector<TournamentGroupMember> members;
+        for (int i = 0; i < 3; i++)
+        {
+            int index = LPRS().randomN(60);
+            Individual* individual = population.subpopulation(0).at(index);
+            members.push_back({individual, index});
+        }
+        TournamentGroup full(members);
+        full.setAllMetrics(full_fitness);
+        // Full evaluation's loser, unless tied.
+        const auto& m = full.members();
+        bool unique = m.at(0).metric < m.at(1).metric;
+        TournamentGroup d = deterministic.race(TournamentGroup(members));
+        TournamentGroup s = statistical.race(TournamentGroup(members));
+        if (unique)
+        {
+            ok = ok && st(d.worstIndividual() == full.worstIndividual());
+            if (s.worstIndividual() == full.worstIndividual())
+            {
+                statistical_agree++;
+            }
+        }
+    }
+    ok = ok && st(deterministic.tournaments() == tournaments);
+    ok = ok && st(deterministic.earlyStops() > 0);
+    ok = ok && st(deterministic.casesEvaluated() <
+                  deterministic.casesPossible());
+    ok = ok && st(statistical.casesEvaluated() <
+                  deterministic.casesEvaluated());
+    ok = ok && st(statistical_agree > 0.9 * tournaments);
+    // Used as a TournamentFunction.
+    population.setLoggerFunction([](Population&){});
+    population.run(20, statistical.tournamentFunction());
+    ok = ok && st(population.getStepCount() == 20);
+    return ok;
+}
+
+bool mini_batch_fitness()
+{
+    bool ok = true;
+    LPRS().setSeed(66290137);
+    // Sampler draws distinct, sorted, in-range cases.
+    FitnessCaseSampler sampler(1000, 20, 5);
+    for (int i = 0; i < 10; i++)
+    {
+        const std::vector<int>& batch = sampler.nextBatch();
+        ok = ok && st(batch.size() == 20);
+        for (size_t j = 0; j < batch.size(); j++)
+        {
+            ok = ok && st((batch[j] >= 0) && (batch[j] < 1000));
+            if (j > 0) { ok = ok && st(batch[j - 1] < batch[j]); }
+        }
+    }
+    ok = ok && st(sampler.batches() == 10);
+    // Population with mini-batch fitness: count cases evaluated.
+    const FunctionSet& fs = TestFS::treeEval();
+    Population population(30, 1, 40, fs);
+    population.setLoggerFunction([](Population&){});
+    population.setFitnessCaseSampler(FitnessCaseSampler(1000, 20, 5));
+    int64_t cases_evaluated = 0;
+    auto batch_fitness = [&](Individual* individual,
+                             const std::vector<int>& cases)
+    {
+        float value = std::any_cast<float>(individual->treeValue());
+        float sum = 0;
+        for (int c : cases) { sum += value + (c % 10) * 0.01; }
+        cases_evaluated += cases.size();
+        return sum / cases.size();
+    };
+    int steps = 100;
+    for (int i = 0; i < steps; i++) { population.evolutionStep(batch_fitness); }
+    ok = ok && st(population.fitnessCaseSampler().batches() == steps);
+    ok = ok && st(cases_evaluated == steps * 3 * 20);
+    // Survivors have estimates averaged over several batches.
+    int max_samples = 0;
+    population.applyToAllIndividuals([&](Individual* i)
+    {
+        max_samples = std::max(max_samples, i->fitnessSamples());
+        ok = ok && st(i->fitnessStep() <= steps);
+    });
+    ok = ok && st(max_samples > 1);
+    // Stale estimates are cleared.
+    int stale = population.refreshStaleFitness(10);
+    ok = ok && st(stale > 0);
+    population.applyToAllIndividuals([&](Individual* i)
+    {
+        if (i->hasFitness())
+        {
+            ok = ok && st(steps - i->fitnessStep() <= 10);
+        }
+    });
+    // Estimate weights only the latest "window" batches in full.
+    Individual individual;
+    for (int i = 0; i < 4; i++) { individual.updateFitnessEstimate(1, 2, i); }
+    individual.updateFitnessEstimate(0, 2, 4);
+    ok = ok && st(individual.getFitness() == 0.5);
+    ok = ok && st(individual.fitnessSamples() == 5);
+    return ok;
+}
+
+bool surrogate_model()
+{
+    bool ok = true;
+    LPRS().setSeed(30987142);
+    const FunctionSet& fs = TestFS::treeEval();
+    // Target fitness depends on features the model sees: fraction of nodes
+    // which are Sqrt, and size.
+    auto target = [](const GpTree& tree)
+    {
+        int sqrt_count = 0;
+        std::function<void(const GpTree&)> count = [&](const GpTree& t)
+        {
+            if (!t.isLeaf() && t.getRootFunction().name() == "Sqrt")
+            {
+                sqrt_count++;
+            }
+            for (auto& subtree : t.subtrees()) { count(subtree); }
+        };
+        count(tree);
+        return 10.0f * sqrt_count / tree.size() - tree.size() * 0.01f;
+    };
+    LinearSurrogate model(fs);
+    ok = ok && st(model.featureCount() == 4 + 5 + 32);
+    auto random_tree = [&]()
+    {
+        GpTree tree;
+        fs.makeRandomTree(LPRS().random2(5, 60), tree);
+        return tree;
+    };
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    for (int i = 0; i < 2000; i++)
+    {
+        GpTree tree = random_tree();
+        model.train(tree, nan, target(tree));
+    }
+    ok = ok && st(model.trainingSamples() == 2000);
+    // Predictions on new trees correlate with true fitness.
+    std::vector<float> predicted;
+    std::vector<float> actual;
+    for (int i = 0; i < 200; i++)
+    {
+        GpTree tree = random_tree();
+        predicted.push_back(model.predict(tree, nan));
+        actual.push_back(target(tree));
+    }
+    auto mean = [](const std::vector<float>& v)
+        { return std::accumulate(v.begin(), v.end(), 0.0f) / v.size(); };
+    float mp = mean(predicted);
+    float ma = mean(actual);
+    float cov = 0, vp = 0, va = 0;
+    for (size_t i = 0; i < predicted.size(); i++)
+    {
+        cov += (predicted[i] - mp) * (actual[i] - ma);
+        vp += (predicted[i] - mp) * (predicted[i] - mp);
+        va += (actual[i] - ma) * (actual[i] - ma);
+    }
+    ok = ok && st(cov / std::sqrt(vp * va) > 0.8);
+    ok = ok && st(model.predictions() == 200);
+    // In a Population, surrogate is trained from real evaluations, then used
+    // to choose among candidate offspring.
+    auto surrogate = std::make_shared<LinearSurrogate>(fs);
+    Population population(50, 1, 40, fs);
+    population.setLoggerFunction([](Population&){});
+    population.setSurrogate(surrogate, 4, 50);
+    int evaluations = 0;
+    auto fitness = [&](Individual* individual)
+    {
+        evaluations++;
+        return target(individual->tree());
+    };
+    for (int i = 0; i < 200; i++) { population.evolutionStep(fitness); }
+    ok = ok && st(surrogate->trainingSamples() == evaluations);
+    ok = ok && st(surrogate->predictions() > 0);
+    ok = ok && st(surrogate->predictions() % 4 == 0);
+    return ok;
+}
+
+bool static_quality_prefilter()
+{
+    bool ok = true;
+    LPRS().setSeed(47215980);
+    const FunctionSet& fs = TestFS::treeEval();
+    // Static quality: fewer uses of Floor is better.
+    std::atomic<int> calls = 0;
+    auto floors = [](const GpTree& tree)
+    {
+        int count = 0;
+        std::function<void(const GpTree&)> walk = [&](const GpTree& t)
+        {
+            if (!t.isLeaf() && (t.getRootFunction().name() == "Floor"))
+            {
+                count++;
+            }
+            for (auto& subtree : t.subtrees()) { walk(subtree); }
+        };
+        walk(tree);
+        return count;
+    };
+    auto quality = [&](const GpTree& tree)
+    {
+        calls++;
+        return -float(floors(tree));
+    };
+    for (bool parallel : {false, true})
+    {
+        calls = 0;
+        Population population(50, 1, 40, fs);
+        population.setLoggerFunction([](Population&){});
+        float initial_floors = 0;
+        population.applyToAllIndividuals([&](Individual* i)
+        {
+            initial_floors += floors(i->tree());
+        });
+        population.setStaticQuality(quality, 6, parallel);
+        int steps = 200;
+        population.run(steps, [](TournamentGroup group){ return group; });
+        ok = ok && st(calls == steps * 6);
+        // Offspring have a cached static quality, and fewer Floors.
+        int offspring = 0;
+        float final_floors = 0;
+        population.applyToAllIndividuals([&](Individual* i)
+        {
+            final_floors += floors(i->tree());
+            if (i->hasStaticQualityMetric())
+            {
+                offspring++;
+                ok = ok && st(i->getStaticQualityMetric() ==
+                              -floors(i->tree()));
+            }
+        });
+        ok = ok && st(offspring > 0);
+        ok = ok && st(final_floors < initial_floors);
+    }
+    return ok;
+}
+
+bool batch_fitness_api()
+{
+    bool ok = true;
+    const FunctionSet& fs = TestFS::treeEval();
+    auto fitness = [](Individual* i) { return -float(i->tree().size()); };
+    // Count calls to, and Individuals measured by, a GroupFitnessFunction.
+    int calls = 0;
+    int measured = 0;
+    bool none_cached = true;
+    auto scalar = Population::groupFitness(fitness);
+    auto group_fitness = [&](const std::vector<Individual*>& individuals)
+    {
+        calls++;
+        measured += individuals.size();
+        for (auto i : individuals) { none_cached &= !i->hasFitness(); }
+        return scalar(individuals);
+    };
+    // Bulk evaluation, in batches of at most 16.
+    LPRS().setSeed(82930175);
+    Population population(40, 1, 20, fs);
+    population.setLoggerFunction([](Population&){});
+    ok = ok && st(population.evaluateAllUnevaluated(group_fitness, 16) == 40);
+    ok = ok && st((calls == 3) && (measured == 40));
+    ok = ok && st(population.evaluateAllUnevaluated(group_fitness) == 0);
+    ok = ok && st(calls == 3);
+    // Per-step: only new offspring (one per step) need fitness.
+    calls = 0;
+    measured = 0;
+    int steps = 100;
+    for (int i = 0; i < steps; i++) { population.evolutionStep(group_fitness); }
+    ok = ok && st(none_cached);
+    ok = ok && st((measured <= steps) && (calls <= steps) && (calls > 0));
+    // Adapted scalar FitnessFunction gives the same run as the scalar form.
+    auto run = [&](bool use_group)
+    {
+        LPRS().setSeed(11385027);
+        Population p(40, 1, 20, fs);
+        p.setLoggerFunction([](Population&){});
+        for (int i = 0; i < steps; i++)
+        {
+            if (use_group)
+            {
+                p.evolutionStep(Population::groupFitness(fitness));
+            }
+            else
+            {
+                p.evolutionStep(fitness);
+            }
+        }
+        std::vector<int> sizes;
+        p.applyToAllIndividuals([&](Individual* i)
+            { sizes.push_back(i->tree().size()); });
+        return sizes;
+    };
+    ok = ok && st(run(false) == run(true));
+    return ok;
+}
+
+bool fitness_case_dataset()
+{
+    bool ok = true;
+    std::string csv = "/tmp/lazy_predator_unit_test_cases.csv";
+    std::string binary = FitnessCaseDataset::binaryPathname(csv);
+    std::remove(binary.c_str());
+    {
+        std::ofstream stream(csv, std::ios::trunc);
+        stream << "x, y,\"label\"\r\n";
+        for (int i = 0; i < 100; i++)
+        {
+            stream << i * 0.5 << "," << i * i << "," << i % 3 << "\n";
+        }
+        stream << "\n1,2,\n";
+    }
+    // Convert on first open, then reuse binary file.
+    FitnessCaseDataset dataset;
+    ok = ok && st(dataset.openCsv(csv) && dataset.converted());
+    ok = ok && st(dataset.openCsv(csv) && !dataset.converted());
+    ok = ok && st(dataset.rowCount() == 101);
+    ok = ok && st(dataset.columnCount() == 3);
+    ok = ok && st(dataset.columnName(1) == "y");
+    ok = ok && st(dataset.columnIndex("label") == 2);
+    ok = ok && st(dataset.columnIndex("z") == -1);
+    ColumnView<float> x = dataset.column<float>("x");
+    ColumnView<float> y = dataset.column<float>(1);
+    ok = ok && st((x.size() == 101) && (x[10] == 5) && (y[10] == 100));
+    ok = ok && st(uintptr_t(x.data()) % 64 == 0);
+    ok = ok && st(std::isnan(dataset.column<float>(2)[100]));
+    // Row subsets.
+    ColumnView<float> s = y.slice(20, 5);
+    ok = ok && st((s.size() == 5) && (s[0] == 400) && (*(s.end() - 1) == 576));
+    std::vector<float> gathered;
+    x.gather({3, 1, 99}, gathered);
+    ok = ok && st(gathered == std::vector<float>({1.5, 0.5, 49.5}));
+    // Other column types.
+    std::string cases = "/tmp/lazy_predator_unit_test_cases.lpcases";
+    using FCD = FitnessCaseDataset;
+    ok = ok && st(FCD::convertCsv(csv, cases, FCD::Int32));
+    FitnessCaseDataset ints(cases);
+    ok = ok && st(ints.valid() && (ints.column<int32_t>("y")[7] == 49));
+    ok = ok && st(FCD::convertCsv(csv, cases, FCD::Float64));
+    ok = ok && st(ints.open(cases) && (ints.column<double>("x")[3] == 1.5));
+    // Int32 values are clamped to its range.
+    {
+        std::ofstream stream(csv, std::ios::trunc);
+        stream << "i\n1e12\n-1e12\n-7.5\n";
+    }
+    ok = ok && st(FCD::convertCsv(csv, cases, FCD::Int32));
+    ok = ok && st(ints.open(cases));
+    ColumnView<int32_t> i = ints.column<int32_t>(0);
+    ok = ok && st(i[0] == std::numeric_limits<int32_t>::max());
+    ok = ok && st(i[1] == std::numeric_limits<int32_t>::min());
+    ok = ok && st(i[2] == -7);
+    // Conversion leaves no temporary file behind.
+    std::filesystem::path directory("/tmp");
+    for (auto& entry : std::filesystem::directory_iterator(directory))
+    {
+        std::string name = entry.path().filename().string();
+        ok = ok && st(name.find("lazy_predator_unit_test_cases.lpcases.") ==
+                      std::string::npos);
+    }
+    // Rows with wrong field count, or files that are not datasets.
+    {
+        std::ofstream stream(csv, std::ios::trunc);
+        stream << "a,b\n1,2\n3\n";
+    }
+    ok = ok && st(!FCD::convertCsv(csv, cases));
+    ok = ok && st(!FitnessCaseDataset(csv).valid());
+    // An invalid dataset has no rows or columns.
+    ok = ok && st(FitnessCaseDataset(csv).rowCount() == 0);
+    ok = ok && st(FitnessCaseDataset(csv).columnCount() == 0);
+    ok = ok && st(FitnessCaseDataset(csv).columnIndex("a") == -1);
+    std::remove(cases.c_str());
+    std::remove(csv.c_str());
+    std::remove(binary.c_str());
+    return ok;
+}
+
+bool parallel_subtree_eval()
+{
+    bool ok = true;
+    // "Blur" is slow. Track how many run at once, and how many ran.
+    std::atomic<int> running = 0;
+    std::atomic<int> max_running = 0;
+    std::atomic<int> blur_calls = 0;
+    FunctionSet fs =
+    {
+        { { "Float", 0.0f, 1.0f } },
+        {
+            {
+                "Blur", "Float", {"Float"}, [&](GpTree& t)
+                {
+                    float x = t.evalSubtree<float>(0);
+                    blur_calls++;
+                    int now = ++running;
+                    int max = max_running;
+                    while (now > max &&
+                           !max_running.compare_exchange_weak(max, now)) {}
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    running--;
+                    return std::any(x * 0.5f + 1);
+                }, 1, 10
+            },
+            {
+                "Add", "Float", {"Float", "Float"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<float>(0) +
+                                    t.evalSubtree<float>(1));
+                }
+            },
+            {
+                "Add4", "Float", {"Float", "Float", "Float", "Float"},
+                [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<float>(0) +
+                                    t.evalSubtree<float>(1) +
+                                    t.evalSubtree<float>(2) +
+                                    t.evalSubtree<float>(3));
+                }
+            },
+            {
+                "First", "Float", {"Float", "Float"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<float>(0));
+                }
+            }
+        }
+    };
+    GpTree tree;
+    std::string source = ("Add4(Blur(Blur(0.1)), Blur(0.2), "
+                          "Blur(Add(Blur(0.3), Blur(0.4))), Blur(0.5))");
+    ok = ok && st(GpTreeParser::parse(fs, source, tree));
+    float sequential = std::any_cast<float>(tree.eval());
+    ok = ok && st(max_running == 1);
+    ThreadPool pool(4);
+    ok = ok && st(pool.threadCount() == 4);
+    // Not parallel until Blur is marked parallel safe, or if not expensive.
+    ok = ok && st(std::any_cast<float>(tree.evalParallel(pool)) == sequential);
+    ok = ok && st(max_running == 1);
+    fs.setParallelSafe("Blur", true);
+    ok = ok && st(std::any_cast<float>(tree.evalParallel(pool, 20)) ==
+                  sequential);
+    ok = ok && st(max_running == 1);
+    // Nor until their parents are marked as evaluating all arguments.
+    ok = ok && st(std::any_cast<float>(tree.evalParallel(pool, 5)) ==
+                  sequential);
+    ok = ok && st(max_running == 1);
+    fs.setStrictArguments("Add4", true);
+    fs.setStrictArguments("Add", true);
+    // Sibling Blurs (and nested ones) run concurrently, same result.
+    ok = ok && st(std::any_cast<float>(tree.evalParallel(pool, 5)) ==
+                  sequential);
+    ok = ok && st(max_running > 1);
+    ok = ok && st(pool.tasksRun() == 6);
+    ok = ok && st(std::any_cast<float>(tree.eval()) == sequential);
+    // Subtrees a non-strict GpFunction skips are not evaluated.
+    GpTree first;
+    ok = ok && st(GpTreeParser::parse(fs, "First(Blur(0.1), Blur(0.2))",
+                                      first));
+    blur_calls = 0;
+    ok = ok && st(std::any_cast<float>(first.evalParallel(pool, 5)) == 1.05f);
+    ok = ok && st(blur_calls == 1);
+    // TaskGroup rethrows exceptions from its tasks.
+    bool caught = false;
+    try
+    {
+        ThreadPool::TaskGroup group(pool);
+        group.run([](){ throw std::runtime_error("test"); });
+        group.wait();
+    }
+    catch (const std::runtime_error&) { caught = true; }
+    ok = ok && st(caught);
+    return ok;
+}
+
+bool thread_pool()
+{
+    bool ok = true;
+    const FunctionSet& fs = TestFS::treeEval();
+    // Start hook runs on each worker, tasks run on workers (or the caller).
+    std::atomic<int> started = 0;
+    ThreadPool pool(4, [&](int){ started++; });
+    std::vector<int> squares(1000, 0);
+    std::atomic<int> bad_index = 0;
+    pool.parallelFor(0, 1000, [&](int i)
+    {
+        int w = ThreadPool::workerIndex();
+        if ((w < -1) || (w >= 4)) { bad_index++; }
+        squares[i] = i * i;
+    }, 10);
+    ok = ok && st(started == 4);
+    ok = ok && st((bad_index == 0) && (squares[999] == 999 * 999));
+    ok = ok && st(ThreadPool::workerIndex() == -1);
+    // LocalRandomSequence replaces LPRS() on its thread while it exists.
+    LPRS().setSeed(12345);
+    uint32_t first = LPRS().nextInt();
+    LPRS().setSeed(12345);
+    {
+        LP::LocalRandomSequence local(12345);
+        ok = ok && st(LPRS().nextInt() == first);
+    }
+    ok = ok && st(LPRS().nextInt() == first);
+    // Workers with the same index in different pools have different LPRS().
+    auto worker_random = [](ThreadPool& pool)
+    {
+        uint32_t random = 0;
+        ThreadPool::TaskGroup group(pool, false);  // Only run on worker.
+        group.run([&](){ random = LPRS().nextInt(); });
+        group.wait();
+        return random;
+    };
+    ThreadPool island_0(1);
+    ThreadPool island_1(1);
+    ok = ok && st(worker_random(island_0) != worker_random(island_1));
+    // Parallel initialization gives the same Population for any pool size.
+    auto trees = [&](ThreadPool* pool)
+    {
+        LPRS().setSeed(20872651);
+        Population::setDefaultThreadPool(pool);
+        Population population(100, 3, 40, fs);
+        Population::setDefaultThreadPool(nullptr);
+        std::string s;
+        population.applyToAllIndividuals([&](Individual* i)
+            { s += i->tree().to_string() + "\n"; });
+        return s;
+    };
+    ThreadPool one(1);
+    ok = ok && st(trees(&pool) == trees(&one));
+    // Statistics and bulk evaluation use the Population's pool.
+    LPRS().setSeed(20872651);
+    Population population(100, 3, 40, fs);
+    population.setLoggerFunction([](Population&){});
+    ok = ok && st(population.threadPool() == nullptr);
+    int sequential_size = population.averageTreeSize();
+    population.setThreadPool(&pool);
+    ok = ok && st(population.averageTreeSize() == sequential_size);
+    auto size_fitness = [](Individual* i) { return float(i->tree().size()); };
+    auto group = Population::groupFitness(size_fitness);
+    ok = ok && st(population.evaluateAllUnevaluated(group, 7) == 100);
+    population.applyToAllIndividuals([&](Individual* i)
+    {
+        ok = ok && st(i->hasFitness() && (i->getFitness() == i->tree().size()));
+    });
+    ok = ok && st(population.evaluateAllUnevaluated(group) == 0);
+    return ok;
+}
+
+bool numa_placement()
+{
+    bool ok = true;
+    std::vector<int> cpus = NumaTopology::parseCpuList("0-3,8,10-11\n");
+    ok = ok && st(cpus == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    ok = ok && st(NumaTopology::detect().nodeCount() >= 1);
+    // Record which threads evaluate trees, and count evaluations of Add.
+    std::mutex mutex;
+    std::set<std::thread::id> eval_threads;
+    std::atomic<int> add_calls = 0;
+    FunctionSet fs =
+    {
+        { { "Float", 0.0f, 1.0f } },
+        {
+            {
+                "Add", "Float", {"Float", "Float"}, [&](GpTree& t)
+                {
+                    add_calls++;
+                    return std::any(t.evalSubtree<float>(0) +
+                                    t.evalSubtree<float>(1));
+                }
+            },
+            {
+                "Where", "Float", {"Float"}, [&](GpTree& t)
+                {
+                    float x = t.evalSubtree<float>(0);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    eval_threads.insert(std::this_thread::get_id());
+                    return std::any(x);
+                }
+            }
+        }
+    };
+    int leaks = Individual::getLeakCount();
+    {
+        LPRS().setSeed(61027854);
+        Population population(60, 3, 20, fs);
+        population.setLoggerFunction([](Population&){});
+        population.setMigrationLikelihood(0.5);
+        // No-op for a single node.
+        typedef std::vector<std::vector<int>> NodeCpus;
+        ok = ok && st(!population.setNumaPlacement(NodeCpus({{0}})));
+        ok = ok && st(!population.numaPlacement());
+        // Two nodes (on any machine, CPUs need not really be on two nodes).
+        int cpu = std::min(1, int(std::thread::hardware_concurrency()) - 1);
+        ok = ok && st(population.setNumaPlacement(NodeCpus({{0}, {cpu}})));
+        ok = ok && st(population.numaPlacement());
+        ok = ok && st((population.numaNode(1) == 1) &&
+                      (population.numaNode(2) == 0));
+        ok = ok && st(population.getIndividualCount() == 60);
+        for (int i = 0; i < 200; i++)
+        {
+            population.evolutionStep([](Individual* i)
+                                     { return -float(i->tree().size()); });
+        }
+        // All trees were evaluated on the islands' workers.
+        ok = ok && st(eval_threads.size() == 3);
+        ok = ok && st(!eval_threads.count(std::this_thread::get_id()));
+        ok = ok && st(population.getIndividualCount() == 60);
+        // Moved Individuals with a cached fitness are not evaluated again.
+        population.applyToAllIndividuals([](Individual* i)
+        {
+            if (!i->hasFitness()) { i->setFitness(0); }
+        });
+        int calls = add_calls;
+        ok = ok && st(population.setNumaPlacement(NodeCpus({{0}, {cpu}})));
+        ok = ok && st(add_calls == calls);
+        // Migrants are made on their island, evaluated there if no fitness.
+        GpTree tree;
+        ok = ok && st(GpTreeParser::parse(fs, "Where(Add(0.25, 0.5))", tree));
+        eval_threads.clear();
+        Individual* migrant = population.insertMigrant(1, tree, true, 3);
+        ok = ok && st(migrant->hasFitness() && (migrant->getFitness() == 3));
+        ok = ok && st(eval_threads.empty() && (add_calls == calls));
+        migrant = population.insertMigrant(2, tree, false, 0);
+        ok = ok && st(!migrant->hasFitness() && (add_calls == calls + 1));
+        ok = ok && st((eval_threads.size() == 1) &&
+                      !eval_threads.count(std::this_thread::get_id()));
+        ok = ok && st(population.getIndividualCount() == 60);
+    }
+    ok = ok && st(Individual::getLeakCount() == leaks);
+    return ok;
+}
+
+bool island_network()
+{
+    bool ok = true;
+    LPRS().setSeed(30918276);
+    const FunctionSet& fs = TestFS::treeEval();
+    // Socket and checkpoints go in a new directory of their own.
+    std::string pattern = (std::filesystem::temp_directory_path() /
+                           "lazy_predator_islands_XXXXXX").string();
+    ok = ok && st(mkdtemp(pattern.data()) != nullptr);
+    std::string directory = pattern;
+    std::string socket = directory + "/islands.sock";
+    // Wait (doing "work" meanwhile) until "condition", giving up after 30s.
+    auto wait_until = [](std::function<bool()> condition,
+                         std::function<void()> work = [](){})
+    {
+        auto deadline = (std::chrono::steady_clock::now() +
+                         std::chrono::seconds(30));
+        while (!condition() && (std::chrono::steady_clock::now() < deadline))
+        {
+            work();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return condition();
+    };
+    int leaks = Individual::getLeakCount();
+    {
+        IslandCoordinator coordinator(socket);
+        ok = ok && st(coordinator.valid());
+        coordinator.start();
+        // Two islands, here in one process, each usually in its own.
+        Population p0(30, 1, 20, fs);
+        Population p1(30, 1, 20, fs);
+        p0.setLoggerFunction([](Population&){});
+        p1.setLoggerFunction([](Population&){});
+        IslandClient island0(socket, p0);
+        IslandClient island1(socket, p1);
+        ok = ok && st(island0.connected() && island1.connected());
+        ok = ok && st((island0.islandId() == 0) && (island1.islandId() == 1));
+        auto fitness = [](Individual* i){ return -float(i->tree().size()); };
+        island0.setMigrationInterval(10);
+        island1.setMigrationInterval(10);
+        island0.setMigrantCount(2);
+        island1.setMigrantCount(2);
+        island0.run(50, fitness);
+        island1.run(50, fitness);
+        ok = ok && st((island0.migrantsSent() == 10) &&
+                      (island1.migrantsSent() == 10));
+        // Coordinated checkpoint, written by each island at next exchange.
+        int epoch = coordinator.requestCheckpoint(directory);
+        auto complete = [&](){ return coordinator.checkpointComplete(epoch); };
+        ok = ok && st(wait_until(complete,
+                                 [&](){
+                                     island0.receive();
+                                     island1.receive();
+                                 }));
+        ok = ok && st(coordinator.checkpointOk(epoch));
+        ok = ok && st(coordinator.migrantsForwarded() == 20);
+        ok = ok && st((island0.migrantsReceived() == 10) &&
+                      (island1.migrantsReceived() == 10));
+        ok = ok && st((p0.getIndividualCount() == 30) &&
+                      (p1.getIndividualCount() == 30));
+        for (int id : {0, 1})
+        {
+            std::string pathname =
+                IslandClient::checkpointPathname(directory, id, epoch);
+            PopulationSnapshot snapshot(pathname);
+            ok = ok && st(snapshot.valid());
+            ok = ok && st(snapshot.getIndividualCount() == 30);
+            std::remove(pathname.c_str());
+        }
+        // A peer sending an oversized frame is disconnected.
+        MessageSocket oversized;
+        ok = ok && st(oversized.connect(socket));
+        uint32_t huge = uint32_t(MessageSocket::maxMessageSize() + 1);
+        ::send(oversized.fd(), &huge, sizeof(huge), MSG_NOSIGNAL);
+        std::vector<std::string> messages;
+        ok = ok && st(oversized.wait(5000) && !oversized.receive(messages));
+        // An island which does not read does not stall the coordinator. (It
+        // follows island1 in the ring, so gets island1's migrants.)
+        MessageSocket slow;
+        ok = ok && st(slow.connect(socket));
+        WireWriter join;
+        join.write(int32_t(MessageSocket::Join));
+        ok = ok && st(slow.send(join.message()));
+        ok = ok && st(wait_until([&](){
+                                     return coordinator.islandCount() == 3;
+                                 }));
+        int64_t forwarded = coordinator.migrantsForwarded();
+        for (int i = 0; i < 200; i++) { island1.sendMigrants(30); }
+        ok = ok && st(wait_until([&](){
+                                     return (coordinator.migrantsForwarded() >=
+                                             forwarded + 6000);
+                                 }));
+        ok = ok && st(coordinator.migrantsForwarded() == forwarded + 6000);
+        ok = ok && st(coordinator.requestCheckpoint(directory) == epoch + 1);
+        slow.close();
+        // A second coordinator does not take over the socket of a running one.
+        ok = ok && st(!IslandCoordinator(socket).valid());
+        ok = ok && st(std::filesystem::exists(socket));
+        ok = ok && st(wait_until([&](){
+                                     return coordinator.islandCount() == 2;
+                                 }));
+        coordinator.stop();
+    }
+    ok = ok && st(Individual::getLeakCount() == leaks);
+    // A socket left by a coordinator which exited is replaced.
+    {
+        sockaddr_un address;
+        ok = ok && st(MessageSocket::socketAddress(socket, address));
+        MessageSocket stale(::socket(AF_UNIX, SOCK_STREAM, 0));
+        ok = ok && st(bind(stale.fd(), reinterpret_cast<sockaddr*>(&address),
+                           sizeof(address)) == 0);
+        stale.close();
+        ok = ok && st(std::filesystem::exists(socket));
+        IslandCoordinator coordinator(socket);
+        ok = ok && st(coordinator.valid());
+        MessageSocket client;
+        ok = ok && st(client.connect(socket));
+    }
+    // A pathname too long for a socket is an error.
+    std::string long_pathname = "/tmp/" + std::string(200, 'x');
+    ok = ok && st(!IslandCoordinator(long_pathname).valid());
+    ok = ok && st(!MessageSocket().connect(long_pathname));
+    // A file which is not a socket is not replaced.
+    std::string not_socket = directory + "/not_socket";
+    std::ofstream(not_socket) << "data" << std::endl;
+    ok = ok && st(!IslandCoordinator(not_socket).valid());
+    ok = ok && st(std::filesystem::exists(not_socket));
+    std::filesystem::remove_all(directory);
+    return ok;
+}
+
+bool coevolution()
+{
+    bool ok = true;
+    // Predators and prey, each a Float-valued tree, with different
+    // FunctionSets. Predators score by being near prey, prey by being far.
+    FunctionSet predator_fs =
+    {
+        { { "Float", 0.0f, 1.0f } },
+        {
+            {
+                "Add", "Float", {"Float", "Float"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<float>(0) +
+                                    t.evalSubtree<float>(1));
+                }
+            }
+        }
+    };
+    FunctionSet prey_fs =
+    {
+        { { "Float", 0.0f, 1.0f } },
+        {
+            {
+                "Mul", "Float", {"Float", "Float"}, [](GpTree& t)
+                {
+                    return std::any(t.evalSubtree<float>(0) *
+                                    t.evalSubtree<float>(1));
+                }
+            }
+        }
+    };
+    auto value = [](Individual* i){ return std::any_cast<float>
+                                           (i->treeValue()); };
+    int steps = 100;
+    int leaks = Individual::getLeakCount();
+    // Run a coevolution, return a summary of final Populations.
+    auto run = [&]()
+    {
+        LPRS().setSeed(74019283);
+        Coevolution coevolution;
+        int predators = coevolution.addPopulation
+            (std::make_unique<Population>(40, 2, 20, predator_fs));
+        int prey = coevolution.addPopulation
+            (std::make_unique<Population>(30, 1, 20, prey_fs));
+        for (int p : {predators, prey})
+        {
+            coevolution.population(p).setLoggerFunction([](Population&){});
+        }
+        coevolution.setEncounter(predators, prey, [&](Individual* a,
+                                                      Individual* b)
+                                 { return -std::abs(value(a) - value(b)); });
+        coevolution.setEncounter(prey, predators, [&](Individual* a,
+                                                      Individual* b)
+                                 { return std::abs(value(a) - value(b)); });
+        coevolution.setOpponentCount(4);
+        ThreadPool pool(3);
+        coevolution.setThreadPool(&pool);
+        coevolution.run(steps);
+        ok = ok && st(coevolution.getStepCount() == steps);
+        ok = ok && st(coevolution.encounterCount() == steps * 2 * 3 * 4);
+        ok = ok && st(coevolution.population(predators).getStepCount() ==
+                      steps);
+        ok = ok && st(coevolution.population(prey).getStepCount() == steps);
+        ok = ok && st(coevolution.population(predators).
+                      getIndividualCount() == 40);
+        ok = ok && st(coevolution.population(prey).getIndividualCount() == 30);
+        std::string summary;
+        for (int p : {predators, prey})
+        {
+            coevolution.population(p).applyToAllIndividuals([&](Individual* i)
+            {
+                summary += i->tree().to_string();
+            });
+        }
+        return summary;
+    };
+    // Same seed, same result, despite parallel encounters and steps.
+    ok = ok && st(run() == run());
+    // Each Population's EvalBudget applies to its trees and encounters.
+    {
+        LPRS().setSeed(52093817);
+        Coevolution coevolution;
+        int predators = coevolution.addPopulation
+            (std::make_unique<Population>(20, 1, 20, predator_fs));
+        int prey = coevolution.addPopulation
+            (std::make_unique<Population>(20, 1, 20, prey_fs));
+        Population& predator_population = coevolution.population(predators);
+        Population& prey_population = coevolution.population(prey);
+        predator_population.setLoggerFunction([](Population&){});
+        prey_population.setLoggerFunction([](Population&){});
+        // Predator encounters run until stopped, which cancels tournaments.
+        predator_population.setEvalBudget
+            (EvalBudget(0, 0.001, EvalBudget::InvalidTournament));
+        coevolution.setEncounter(predators, prey, [](Individual*, Individual*)
+        {
+            while (!EvalBudget::shouldStop()) {}
+            return 0.0f;
+        });
+        // Prey trees with more than 9 function nodes are over budget.
+        prey_population.setEvalBudget(EvalBudget(9, 0));
+        coevolution.setEncounter(prey, predators, [&](Individual* a,
+                                                      Individual* b)
+                                 { return std::abs(value(a) - value(b)); });
+        coevolution.setOpponentCount(2);
+        coevolution.run(5);
+        ok = ok && st(predator_population.getOverBudgetCount() > 0);
+        ok = ok && st(prey_population.getOverBudgetCount() > 0);
+        int predators_over = 0;
+        int prey_over = 0;
+        predator_population.applyToAllIndividuals([&](Individual* i)
+            { predators_over += i->overBudget(); });
+        prey_population.applyToAllIndividuals([&](Individual* i)
+            { prey_over += i->overBudget(); });
+        ok = ok && st((predators_over == 0) && (prey_over > 0));
+    }
+    ok = ok && st(Individual::getLeakCount() == leaks);
+    return ok;
+}
+
 bool UnitTests::allTestsOK()
 {
     //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -474,6 +2387,29 @@ bool UnitTests::allTestsOK()
     logAndTally(gp_type_deleter);
     logAndTally(subpopulation_and_stats);
     logAndTally(subpopulation_migration);
+    logAndTally(population_snapshot);
+    logAndTally(gp_tree_parser);
+    logAndTally(gp_tree_to_string);
+    logAndTally(population_instrumentation);
+    logAndTally(gp_function_profiler);
+    logAndTally(gp_tree_cost_budget);
+    logAndTally(population_bloat_control);
+    logAndTally(function_set_ids);
+    logAndTally(eval_plan);
+    logAndTally(native_code);
+    logAndTally(eval_workers);
+    logAndTally(eval_budget);
+    logAndTally(racing);
+    logAndTally(mini_batch_fitness);
+    logAndTally(surrogate_model);
+    logAndTally(static_quality_prefilter);
+    logAndTally(batch_fitness_api);
+    logAndTally(fitness_case_dataset);
+    logAndTally(parallel_subtree_eval);
+    logAndTally(thread_pool);
+    logAndTally(numa_placement);
+    logAndTally(island_network);
+    logAndTally(coevolution);
     
     // Reset LazyPredator's global RandomSequence to default seed.
     LPRS().setSeed();
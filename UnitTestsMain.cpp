@@ -0,0 +1,17 @@
+//
+//  UnitTestsMain.cpp
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Runs only the unit tests, with exit status indicating success. Used by the
+// unit test target in CMakeLists.txt. (main.cpp is for the Xcode project.)
+
+#include "LazyPredator.h"
+
+int main()
+{
+    return UnitTests::allTestsOK() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -12,14 +12,23 @@
 #include <any>
 #include <set>
 #include <limits>
+#include <sstream>
 
 // TODO UTILITIES_NAMESPACES
 // TODO temporarily share utilities with TexSyn
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // TODO 20240229 fixes in LazyPredator and TexSyn while debugging evoflock.
 //#include "../TexSyn/TexSyn.h"
+// Use TexSyn's utilities when a sibling TexSyn checkout is present, unless
+// LAZY_PREDATOR_STANDALONE is defined (as by CMakeLists.txt). Otherwise use
+// minimal local versions of the same utilities.
+#if (!defined(LAZY_PREDATOR_STANDALONE) && \
+     __has_include("../TexSyn/Utilities.h"))
 #include "../TexSyn/Utilities.h"
 #include "../TexSyn/RandomSequence.h"
+#else
+#include "StandaloneUtilities.h"
+#endif
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
  
@@ -28,8 +37,31 @@
 class LP
 {
 public:
-    static RandomSequence& randomSequence() { return random_sequence; }
+    static RandomSequence& randomSequence()
+    {
+        return local_random_sequence ? *local_random_sequence : random_sequence;
+    }
+    // While one exists, LPRS() on its thread is this sequence, not the global
+    // one. For random numbers on other threads, for example tasks on a
+    // ThreadPool, which can be seeded from the global sequence beforehand so
+    // results do not depend on scheduling.
+    class LocalRandomSequence
+    {
+    public:
+        LocalRandomSequence(uint64_t seed)
+          : sequence_(seed), previous_(local_random_sequence)
+        {
+            local_random_sequence = &sequence_;
+        }
+        ~LocalRandomSequence() { local_random_sequence = previous_; }
+        LocalRandomSequence(const LocalRandomSequence&) = delete;
+        LocalRandomSequence& operator=(const LocalRandomSequence&) = delete;
+    private:
+        RandomSequence sequence_;
+        RandomSequence* previous_;
+    };
 private:
     static inline RandomSequence random_sequence;
+    static inline thread_local RandomSequence* local_random_sequence = nullptr;
 };
 inline RandomSequence& LPRS() { return LP::randomSequence(); }
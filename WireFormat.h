@@ -0,0 +1,123 @@
+//
+//  WireFormat.h
+//  LazyPredator
+//
+//  Created by agent on 10/18/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+//
+// Compact binary messages for sending GpTrees (and numbers) to another process
+// which has the same FunctionSet, for example a forked evaluation worker.
+// GpFunctions and GpTypes are written as their id(). Leaf values are written
+// as text from GpType::identityString() (exact for floating point) and read
+// with GpType::from_string(), so leaf GpTypes must have both.
+
+#pragma once
+#include "FunctionSet.h"
+#include <cstring>
+
+// Append values to a message (an std::string of bytes).
+class WireWriter
+{
+public:
+    // Append a trivially copyable value (int, float, ...) as raw bytes.
+    template <typename T> void write(T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        message_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void writeString(const std::string& s)
+    {
+        write(uint32_t(s.size()));
+        message_ += s;
+    }
+    // Write tree in preorder: function id(), or -1 - type id() for a leaf.
+    void writeTree(const GpTree& tree)
+    {
+        if (tree.isLeaf())
+        {
+            const GpType& type = *tree.getRootType();
+            assert(type.hasToString() && type.hasFromString());
+            write(int32_t(-1 - type.id()));
+            writeString(type.identityString(tree.getRootValue()));
+        }
+        else
+        {
+            write(int32_t(tree.getRootFunction().id()));
+            for (auto& subtree : tree.subtrees()) { writeTree(subtree); }
+        }
+    }
+    const std::string& message() const { return message_; }
+    void clear() { message_.clear(); }
+private:
+    std::string message_;
+};
+
+// Read values from a message in the order they were written. After reading
+// past the end, or a malformed tree, ok() is false.
+class WireReader
+{
+public:
+    WireReader(const std::string& message) : message_(message) {}
+    template <typename T> T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value{};
+        if (available(sizeof(T)))
+        {
+            std::memcpy(&value, message_.data() + position_, sizeof(T));
+            position_ += sizeof(T);
+        }
+        return value;
+    }
+    std::string readString()
+    {
+        size_t size = read<uint32_t>();
+        std::string s;
+        if (available(size))
+        {
+            s = message_.substr(position_, size);
+            position_ += size;
+        }
+        return s;
+    }
+    // Read a tree written by WireWriter::writeTree() into "tree".
+    void readTree(const FunctionSet& function_set, GpTree& tree)
+    {
+        int32_t tag = read<int32_t>();
+        int function_count = int(function_set.gpFunctions().size());
+        int type_count = int(function_set.gpTypes().size());
+        if (!ok_) return;
+        if (tag >= 0)
+        {
+            if (tag >= function_count) { ok_ = false; return; }
+            const GpFunction& function = function_set.gpFunctionById(tag);
+            tree.setRootFunction(function);
+            tree.addSubtrees(function.parameterTypes().size());
+            for (auto& subtree : tree.subtrees())
+            {
+                readTree(function_set, subtree);
+            }
+        }
+        else
+        {
+            int type_id = -1 - tag;
+            if (type_id >= type_count) { ok_ = false; return; }
+            const GpType& type = function_set.gpTypeById(type_id);
+            std::any value = type.from_string(readString());
+            if (!value.has_value()) { ok_ = false; return; }
+            tree.setRootValue(value, type);
+        }
+    }
+    bool ok() const { return ok_; }
+    bool atEnd() const { return position_ == message_.size(); }
+private:
+    bool available(size_t size)
+    {
+        if (position_ + size > message_.size()) { ok_ = false; }
+        return ok_;
+    }
+    const std::string& message_;
+    size_t position_ = 0;
+    bool ok_ = true;
+};